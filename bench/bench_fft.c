@@ -0,0 +1,381 @@
+// bench_fft.c
+//
+// Micro-benchmarks for the analysis kernels: fft(), apply_window_function,
+// band accumulation (compute_log_bands) and computePowerSpectrum, plus FFTW
+// complex and real-input transforms for comparison, over transform sizes 2^8 to 2^20. Built with FFT_SIZE set
+// to the largest size so one set of precomputed tables serves every size.
+// The resampler is timed alongside at each quality, converting n frames of
+// one channel from 48 kHz to 44.1 kHz.
+//
+// Each kernel/size pair gets a warm-up, then a number of timed trials of a
+// calibrated repetition count; the process is pinned to one CPU where the
+// platform allows it. Results are written as JSON so runs can be diffed.
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#else
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/fft.h"
+#include "../include/resample.h"
+
+#ifndef BENCH_NO_FFTW
+#include <fftw3.h>
+#endif
+
+#define MIN_LOG2_SIZE 8
+#define MAX_LOG2_SIZE 20
+#define DEFAULT_TRIALS 11
+#define WARMUP_SECONDS 0.05
+#define TRIAL_SECONDS 0.01
+
+#if (1 << MAX_LOG2_SIZE) > FFT_SIZE
+#error "bench_fft.c must be built with FFT_SIZE >= 2^MAX_LOG2_SIZE"
+#endif
+
+typedef struct {
+    const char *name;
+    void (*run)(size_t n);
+    double flopsPerPoint;    /**< GFLOP/s model in n log2(n) units (5 complex, 2.5 real input); 0 for none */
+    void (*prepare)(size_t n); /**< Untimed setup before a size's warm-up; may be NULL */
+} BenchKernel;
+
+typedef struct {
+    double nsMin;
+    double nsMedian;
+    double nsMax;
+    size_t iterations;       /**< Kernel calls per trial */
+} BenchResult;
+
+// Large enough that it should not live on the stack
+static AudioData audioData;
+
+static void run_fft(size_t n) {
+    fft(&audioData, n);
+}
+
+static void run_window(size_t n) {
+    apply_window_function(audioData.in_raw, audioData.in_win, n);
+}
+
+static void run_bands(size_t n) {
+    compute_log_bands(&audioData, n);
+}
+
+static void run_power(size_t n) {
+    computePowerSpectrum(&audioData, n);
+}
+
+// 48 kHz noise, long enough for the largest output size
+#define RESAMPLE_INPUT_FRAMES (((size_t)1 << MAX_LOG2_SIZE) * 160 / 147 + 1024)
+static Resampler resamplers[RESAMPLE_QUALITY_COUNT];
+static float *resampleInput;
+static float *resampleOutput;
+
+static void run_resample(ResampleQuality quality, size_t n) {
+    const Resampler *resampler = &resamplers[quality];
+    resampler_process(resampler, resampleInput, resampler_first_input(resampler, 0), 0, resampleOutput, n);
+}
+
+static void run_resample_fast(size_t n) {
+    run_resample(RESAMPLE_FAST, n);
+}
+
+static void run_resample_medium(size_t n) {
+    run_resample(RESAMPLE_MEDIUM, n);
+}
+
+static void run_resample_best(size_t n) {
+    run_resample(RESAMPLE_BEST, n);
+}
+
+#ifndef BENCH_NO_FFTW
+static float *fftwRealInput;
+static fftwf_complex *fftwComplexInput;
+static fftwf_complex *fftwOutput;
+static fftwf_plan fftwR2cPlan;
+static fftwf_plan fftwC2cPlan;
+static size_t fftwR2cSize;
+static size_t fftwC2cSize;
+
+// FFTW_MEASURE planning takes far longer than a transform, so it happens
+// here, before the warm-up that calibrates the iteration count. Planning
+// overwrites the arrays, so the input is refilled afterwards.
+static void prepare_fftw_r2c(size_t n) {
+    if (n == fftwR2cSize) return;
+    if (fftwR2cSize != 0) fftwf_destroy_plan(fftwR2cPlan);
+    fftwR2cPlan = fftwf_plan_dft_r2c_1d((int)n, fftwRealInput, fftwOutput, FFTW_MEASURE);
+    memcpy(fftwRealInput, audioData.in_win, n * sizeof(float));
+    fftwR2cSize = n;
+}
+
+// fft() transforms its real input as a full complex sequence, so this is
+// the like-for-like reference: the same input with a zero imaginary part
+static void prepare_fftw_c2c(size_t n) {
+    if (n == fftwC2cSize) return;
+    if (fftwC2cSize != 0) fftwf_destroy_plan(fftwC2cPlan);
+    fftwC2cPlan = fftwf_plan_dft_1d((int)n, fftwComplexInput, fftwOutput, FFTW_FORWARD, FFTW_MEASURE);
+    for (size_t i = 0; i < n; ++i) {
+        fftwComplexInput[i][0] = audioData.in_win[i];
+        fftwComplexInput[i][1] = 0.0f;
+    }
+    fftwC2cSize = n;
+}
+
+static void run_fftw_r2c(size_t n) {
+    (void)n;
+    fftwf_execute(fftwR2cPlan);
+}
+
+static void run_fftw_c2c(size_t n) {
+    (void)n;
+    fftwf_execute(fftwC2cPlan);
+}
+#endif
+
+static const BenchKernel kernels[] = {
+    { "fft",                   run_fft,    5.0, NULL },
+    { "apply_window_function", run_window, 0.0, NULL },
+    { "compute_log_bands",     run_bands,  0.0, NULL },
+    { "computePowerSpectrum",  run_power,  0.0, NULL },
+    { "resample_fast",         run_resample_fast,   0.0, NULL },
+    { "resample_medium",       run_resample_medium, 0.0, NULL },
+    { "resample_best",         run_resample_best,   0.0, NULL },
+#ifndef BENCH_NO_FFTW
+    { "fftw_c2c",              run_fftw_c2c, 5.0, prepare_fftw_c2c },
+    { "fftw_r2c",              run_fftw_r2c, 2.5, prepare_fftw_r2c },
+#endif
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Pin the calling thread to one CPU to keep migrations and
+ * cross-core cache effects out of the timings.
+ *
+ * @param cpu The CPU index.
+ * @return true if the affinity was applied.
+ */
+static bool pin_to_cpu(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    // macOS only offers affinity hints; run unpinned
+    (void)cpu;
+    return false;
+#endif
+}
+
+static BenchResult run_benchmark(const BenchKernel *kernel, size_t n, int trials, double *trialTimes) {
+    BenchResult result;
+
+    if (kernel->prepare != NULL) kernel->prepare(n);
+
+    // Warm-up also calibrates how many calls fill one trial
+    size_t calls = 0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+    do {
+        kernel->run(n);
+        calls++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < WARMUP_SECONDS || calls < 3);
+
+    double perCall = elapsed / (double)calls;
+    size_t iterations = (size_t)(TRIAL_SECONDS / perCall);
+    if (iterations < 1) iterations = 1;
+
+    for (int t = 0; t < trials; ++t) {
+        double trialStart = now_seconds();
+        for (size_t i = 0; i < iterations; ++i) {
+            kernel->run(n);
+        }
+        trialTimes[t] = (now_seconds() - trialStart) * 1e9 / (double)iterations;
+    }
+
+    qsort(trialTimes, (size_t)trials, sizeof(double), compare_doubles);
+    result.nsMin = trialTimes[0];
+    result.nsMax = trialTimes[trials - 1];
+    result.nsMedian = (trials % 2) ? trialTimes[trials / 2]
+                                   : 0.5 * (trialTimes[trials / 2 - 1] + trialTimes[trials / 2]);
+    result.iterations = iterations;
+    return result;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -o <file>   Write JSON results to file (default: stdout)\n"
+            "  -c <cpu>    CPU to pin to (default: 0)\n"
+            "  -t <n>      Timed trials per kernel and size (default: %d)\n"
+            "  -m <log2>   Smallest size as a power of two (default: %d)\n"
+            "  -M <log2>   Largest size as a power of two (default: %d)\n",
+            program, DEFAULT_TRIALS, MIN_LOG2_SIZE, MAX_LOG2_SIZE);
+}
+
+int main(int argc, char **argv) {
+    const char *outputPath = NULL;
+    int cpu = 0;
+    int trials = DEFAULT_TRIALS;
+    int minLog2 = MIN_LOG2_SIZE;
+    int maxLog2 = MAX_LOG2_SIZE;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-o") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && hasValue) {
+            cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && hasValue) {
+            trials = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && hasValue) {
+            minLog2 = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-M") == 0 && hasValue) {
+            maxLog2 = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (trials < 1 || minLog2 < 1 || maxLog2 > MAX_LOG2_SIZE || minLog2 > maxLog2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (outputPath != NULL) {
+        out = fopen(outputPath, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Failed to open output file %s\n", outputPath);
+            return 1;
+        }
+    }
+
+    bool pinned = pin_to_cpu(cpu);
+    if (!pinned) {
+        fprintf(stderr, "Warning: could not pin to CPU %d, timings may be noisier\n", cpu);
+    }
+
+    init_audio_data(&audioData, SAMPLE_RATE);
+
+    // Broadband input so no kernel sees a degenerate (all-zero) signal
+    NoiseGenerator noise;
+    noise_seed(&noise, NOISE_DEFAULT_SEED);
+    noise_white(&noise, audioData.in_raw, FFT_SIZE);
+    memcpy(audioData.in_win, audioData.in_raw, sizeof(audioData.in_win));
+    fft(&audioData, FFT_SIZE);
+
+    resampleInput = malloc(sizeof(float) * RESAMPLE_INPUT_FRAMES);
+    resampleOutput = malloc(sizeof(float) * ((size_t)1 << MAX_LOG2_SIZE));
+    if (resampleInput == NULL || resampleOutput == NULL) {
+        fprintf(stderr, "Failed to allocate resampler buffers\n");
+        return 1;
+    }
+    noise_white(&noise, resampleInput, RESAMPLE_INPUT_FRAMES);
+    for (int q = 0; q < RESAMPLE_QUALITY_COUNT; ++q) {
+        if (!resampler_init(&resamplers[q], 48000, 44100, (ResampleQuality)q)) {
+            fprintf(stderr, "Failed to build the %s resampler\n", resample_quality_name((ResampleQuality)q));
+            return 1;
+        }
+    }
+
+#ifndef BENCH_NO_FFTW
+    fftwRealInput = fftwf_malloc(sizeof(float) * FFT_SIZE);
+    fftwComplexInput = fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
+    fftwOutput = fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
+#endif
+
+    double *trialTimes = malloc(sizeof(double) * (size_t)trials);
+    if (trialTimes == NULL) {
+        fprintf(stderr, "Failed to allocate trial buffer\n");
+        return 1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"fft\",\n");
+    fprintf(out, "  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(out, "  \"cpu\": %d,\n", cpu);
+    fprintf(out, "  \"pinned\": %s,\n", pinned ? "true" : "false");
+    fprintf(out, "  \"trials\": %d,\n", trials);
+    fprintf(out, "  \"flop_model\": \"5 n log2(n) per complex transform, 2.5 n log2(n) per real-input transform\",\n");
+    fprintf(out, "  \"results\": [");
+
+    size_t kernelCount = sizeof(kernels) / sizeof(kernels[0]);
+    bool first = true;
+    for (int log2n = minLog2; log2n <= maxLog2; ++log2n) {
+        size_t n = (size_t)1 << log2n;
+        double fftMedian = 0.0;
+        double referenceMedian = 0.0;
+
+        for (size_t k = 0; k < kernelCount; ++k) {
+            const BenchKernel *kernel = &kernels[k];
+            BenchResult result = run_benchmark(kernel, n, trials, trialTimes);
+
+            if (strcmp(kernel->name, "fft") == 0) fftMedian = result.nsMedian;
+            if (strcmp(kernel->name, "fftw_c2c") == 0) referenceMedian = result.nsMedian;
+
+            fprintf(out, "%s\n    {\"kernel\": \"%s\", \"n\": %zu, \"iterations\": %zu, "
+                         "\"ns_min\": %.1f, \"ns_median\": %.1f, \"ns_max\": %.1f, "
+                         "\"ns_per_point\": %.3f",
+                    first ? "" : ",", kernel->name, n, result.iterations,
+                    result.nsMin, result.nsMedian, result.nsMax, result.nsMedian / (double)n);
+            if (kernel->flopsPerPoint > 0.0) {
+                fprintf(out, ", \"gflops\": %.3f", kernel->flopsPerPoint * (double)n * log2n / result.nsMedian);
+            }
+            fprintf(out, "}");
+            first = false;
+
+            fprintf(stderr, "%-22s n=2^%-2d %12.1f ns\n", kernel->name, log2n, result.nsMedian);
+        }
+
+        if (fftMedian > 0.0 && referenceMedian > 0.0) {
+            fprintf(out, ",\n    {\"kernel\": \"fft_vs_fftw\", \"reference\": \"fftw_c2c\", \"n\": %zu, \"ratio\": %.3f}",
+                    n, fftMedian / referenceMedian);
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) fclose(out);
+    free(trialTimes);
+    free(resampleInput);
+    free(resampleOutput);
+    for (int q = 0; q < RESAMPLE_QUALITY_COUNT; ++q) {
+        resampler_free(&resamplers[q]);
+    }
+
+#ifndef BENCH_NO_FFTW
+    if (fftwR2cSize != 0) fftwf_destroy_plan(fftwR2cPlan);
+    if (fftwC2cSize != 0) fftwf_destroy_plan(fftwC2cPlan);
+    fftwf_free(fftwRealInput);
+    fftwf_free(fftwComplexInput);
+    fftwf_free(fftwOutput);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+// alloc_tracker.h
+
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ALLOC_TRACKER_MAX_THREADS 16     // Threads tracked individually
+#define ALLOC_TRACKER_WARMUP_FRAMES 120  // Frames ignored after start-up
+
+#ifdef ENABLE_ALLOC_TRACKER
+
+#define ALLOC_TRACKER_NAME_THREAD(name) alloc_tracker_name_thread(name, false)
+#define ALLOC_TRACKER_NAME_WORKER(name) alloc_tracker_name_thread(name, true)
+#define ALLOC_TRACKER_ALLOW_FRAME() alloc_tracker_allow_frame()
+#define ALLOC_TRACKER_FRAME_END() alloc_tracker_end_frame()
+
+/**
+ * @brief Name the calling thread in reports. Only the first call per thread
+ * has an effect, so it is cheap to call from a callback.
+ *
+ * @param name A string literal.
+ * @param worker True for background threads that are expected to allocate
+ * (decoders, loaders); they are counted but never reported per frame.
+ */
+void alloc_tracker_name_thread(const char *name, bool worker);
+
+/**
+ * @brief Mark the current frame as one that is expected to allocate
+ * (loading a song, a dropped file, a new window table).
+ */
+void alloc_tracker_allow_frame(void);
+
+/**
+ * @brief Close the current frame: report every thread that allocated or
+ * freed during it, unless the frame was allowed or still warming up.
+ */
+void alloc_tracker_end_frame(void);
+
+/**
+ * @brief Print per-thread totals and the number of violating frames.
+ */
+void alloc_tracker_print_summary(void);
+
+#else
+
+#define ALLOC_TRACKER_NAME_THREAD(name) ((void)0)
+#define ALLOC_TRACKER_NAME_WORKER(name) ((void)0)
+#define ALLOC_TRACKER_ALLOW_FRAME() ((void)0)
+#define ALLOC_TRACKER_FRAME_END() ((void)0)
+
+#endif // ENABLE_ALLOC_TRACKER
+
+#endif // ALLOC_TRACKER_H
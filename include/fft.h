@@ -4,14 +4,21 @@
 #define AUDIO_PROCESSING_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <complex.h>
 #include <stdbool.h>
+#include "window.h"
+#include "noise.h"
 
 // Define FFT_SIZE as a power of 2
 #ifndef FFT_SIZE
 #define FFT_SIZE (1 << 14) // Default to 16384
 #endif
 
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE 44100.0f
+#endif
+
 /**
  * @brief Structure to hold audio data for processing.
  */
@@ -24,6 +31,9 @@ typedef struct {
     float out_phase[FFT_SIZE];   /**< Phase spectrum */
     float out_power[FFT_SIZE];   /**< Power spectrum */
     size_t bufferIndex;          /**< Current index in the circular buffer */
+    uint64_t samplePosition;     /**< Samples ever written to the circular buffer */
+    uint64_t spectrumPosition;   /**< samplePosition the current spectrum was taken at */
+    float sampleRate;            /**< Rate the ring is filled at (Hz) */
 } AudioData;
 
 /**
@@ -33,9 +43,44 @@ typedef enum {
     TEST_SIGNAL_SINE,        /**< Single sine wave */
     TEST_SIGNAL_MULTI_SINE,  /**< Multiple sine waves summed together */
     TEST_SIGNAL_CHIRP,       /**< Chirp signal sweeping frequencies */
-    TEST_SIGNAL_NOISE        /**< White noise */
+    TEST_SIGNAL_NOISE,       /**< White noise */
+    TEST_SIGNAL_PINK_NOISE,  /**< Pink (-3 dB/octave) noise */
+    TEST_SIGNAL_BROWN_NOISE  /**< Brown (-6 dB/octave) noise */
 } TestSignalType;
 
+/**
+ * @brief Recursive sine oscillator (rotating unit phasor).
+ */
+typedef struct {
+    float _Complex phasor;   /**< Current phase as a unit phasor */
+    float _Complex rotation; /**< Per-sample rotation e^(i*2*pi*f/fs) */
+} Oscillator;
+
+/**
+ * @brief Repeating linear chirp built from a rotating rotation.
+ */
+typedef struct {
+    float _Complex phasor;        /**< Current phase as a unit phasor */
+    float _Complex rotation;      /**< Current per-sample rotation (instantaneous frequency) */
+    float _Complex startRotation; /**< Rotation at the start of a sweep */
+    float _Complex sweep;         /**< Per-sample change of the rotation */
+    size_t sweepLength;           /**< Samples per sweep */
+    size_t position;              /**< Sample position within the current sweep */
+} ChirpOscillator;
+
+/**
+ * @brief Phase-continuous source for the test signals.
+ */
+typedef struct {
+    TestSignalType type;      /**< Signal being generated */
+    Oscillator tones[2];      /**< Sine and multi-sine oscillators */
+    size_t toneCount;         /**< Number of active entries in tones */
+    ChirpOscillator chirp;    /**< Chirp state */
+    NoiseGenerator noise;     /**< Seeded source for the noise signals */
+    double pendingSamples;    /**< Fractional samples carried between frames */
+    float sampleRate;         /**< Rate the signal is generated at (Hz) */
+} TestSignalGenerator;
+
 /**
  * @brief Enumeration of frequency scaling types for visualization.
  */
@@ -45,7 +90,16 @@ typedef enum {
     SCALE_MEL           /**< Mel scale frequency scaling */
 } FrequencyScale;
 
+/**
+ * @brief Enumeration of spectrum analysis modes.
+ */
+typedef enum {
+    ANALYSIS_SINGLE_RESOLUTION, /**< One FFT_SIZE transform for all bands */
+    ANALYSIS_MULTI_RESOLUTION   /**< Short FFTs for high bands, long FFTs for bass */
+} AnalysisMode;
+
 extern TestSignalType currentTestSignal; /**< Global variable to set the current test signal type */
+extern AnalysisMode currentAnalysisMode; /**< Global variable to select the spectrum analysis mode */
 extern bool testMode;                    /**< Global flag to indicate if test mode is active */
 
 // Function declarations
@@ -54,8 +108,9 @@ extern bool testMode;                    /**< Global flag to indicate if test mo
  * @brief Initialize the AudioData structure and precompute necessary coefficients.
  *
  * @param audioData Pointer to the AudioData structure to initialize.
+ * @param sampleRate Rate the input ring will be filled at (Hz).
  */
-void init_audio_data(AudioData *audioData);
+void init_audio_data(AudioData *audioData, float sampleRate);
 
 /**
  * @brief Audio processing callback function for handling incoming audio data.
@@ -65,6 +120,16 @@ void init_audio_data(AudioData *audioData);
  */
 void callback(void *bufferData, unsigned int frames);
 
+/**
+ * @brief Append samples to the circular input buffer.
+ *
+ * @param audioData Pointer to the AudioData structure owning the ring.
+ * @param samples Pointer to the first sample to copy.
+ * @param count The number of samples to append.
+ * @param stride Distance between consecutive samples (channel count for interleaved audio).
+ */
+void write_audio_ring(AudioData *audioData, const float *samples, size_t count, size_t stride);
+
 /**
  * @brief Apply a window function to the input signal.
  *
@@ -74,6 +139,18 @@ void callback(void *bufferData, unsigned int frames);
  */
 void apply_window_function(const float input[], float output[], size_t n);
 
+/**
+ * @brief Compute the band spectrum from the newest FFT_SIZE samples in the input ring.
+ *
+ * Independent of the window system and playback state; ProcessFFT and the
+ * headless analyzer both drive it.
+ *
+ * @param audioData Pointer to the AudioData structure containing audio buffers.
+ * @param dt Time since the previous analysis frame, used for smoothing (seconds).
+ * @return The number of frequency bins computed.
+ */
+size_t analyze_spectrum(AudioData *audioData, float dt);
+
 /**
  * @brief Process the FFT and compute the amplitude spectrum for visualization.
  *
@@ -133,6 +210,14 @@ void set_audio_data(AudioData *audioData);
  */
 float getPerceptualWeight(float frequency);
 
+/**
+ * @brief Average the FFT output into the logarithmic visualization bands.
+ *
+ * @param audioData Pointer to the AudioData structure holding the FFT output.
+ * @param n The size of the FFT that produced out_raw.
+ */
+void compute_log_bands(AudioData *audioData, size_t n);
+
 /**
  * @brief Compute the maximum perceptual weight within a frequency range.
  *
@@ -143,14 +228,27 @@ float getPerceptualWeight(float frequency);
 float getMaxPerceptualWeight(float minFreq, float maxFreq);
 
 /**
- * @brief Compute the window coefficients using a Hanning window function.
+ * @brief Select the window function used by apply_window_function.
+ *
+ * @param type The window function to switch to.
  */
-void compute_hann_window_coefficients(void);
+void set_window_function(WindowType type);
 
 /**
- * @brief Compute the window coefficients using a Blackman-Harris  window function.
+ * @brief Get the window function currently used by apply_window_function.
+ *
+ * @return The active window type.
  */
+WindowType get_window_function(void);
 
+/**
+ * @brief Select the Hanning window (same as set_window_function(WINDOW_HANN)).
+ */
+void compute_hann_window_coefficients(void);
+
+/**
+ * @brief Select the Blackman-Harris window (same as set_window_function(WINDOW_BLACKMAN_HARRIS)).
+ */
 void compute_bh_window_coefficients(void);
 
 
@@ -168,6 +266,15 @@ void compute_bit_reversal_indices(size_t n);
  */
 void compute_twiddle_factors(size_t n);
 
+/**
+ * @brief Perform an FFT of a real signal into a separate complex buffer.
+ *
+ * @param input The real input signal.
+ * @param output The complex output buffer (n values).
+ * @param n The size of the FFT (power of 2, at most the precomputed table size).
+ */
+void fft_transform(const float input[], float complex output[], size_t n);
+
 /**
  * @brief Perform an in-place iterative FFT using precomputed twiddle factors and bit-reversal indices.
  *
@@ -177,7 +284,7 @@ void compute_twiddle_factors(size_t n);
 void fft(AudioData *audioData, size_t n);
 
 /**
- * @brief Generate white noise.
+ * @brief Generate white noise from a fixed-seed generator.
  *
  * @param buffer The output buffer to store the white noise samples.
  * @param length The number of samples to generate.
@@ -216,6 +323,71 @@ void generateMultiSineWave(float *buffer, size_t length, float *frequencies, siz
  */
 void generateSineWave(float *buffer, size_t length, float frequency, float sampleRate);
 
+/**
+ * @brief Initialise a recursive sine oscillator.
+ *
+ * @param osc Pointer to the Oscillator to initialise.
+ * @param frequency The oscillator frequency (Hz).
+ * @param sampleRate The sampling rate (Hz).
+ */
+void oscillator_init(Oscillator *osc, float frequency, float sampleRate);
+
+/**
+ * @brief Add the next samples of an oscillator into a buffer.
+ *
+ * @param osc Pointer to the Oscillator.
+ * @param buffer The buffer to accumulate into.
+ * @param length The number of samples to produce.
+ * @param gain Amplitude applied to the oscillator output.
+ */
+void oscillator_mix(Oscillator *osc, float *buffer, size_t length, float gain);
+
+/**
+ * @brief Initialise a repeating linear chirp.
+ *
+ * @param chirp Pointer to the ChirpOscillator to initialise.
+ * @param startFreq The starting frequency of each sweep (Hz).
+ * @param endFreq The ending frequency of each sweep (Hz).
+ * @param sweepLength The number of samples per sweep.
+ * @param sampleRate The sampling rate (Hz).
+ */
+void chirp_init(ChirpOscillator *chirp, float startFreq, float endFreq, size_t sweepLength, float sampleRate);
+
+/**
+ * @brief Write the next samples of a chirp into a buffer.
+ *
+ * @param chirp Pointer to the ChirpOscillator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to produce.
+ */
+void chirp_generate(ChirpOscillator *chirp, float *buffer, size_t length);
+
+/**
+ * @brief Prepare a generator for a test signal type.
+ *
+ * @param gen Pointer to the TestSignalGenerator.
+ * @param type The test signal to produce.
+ * @param sampleRate The sampling rate (Hz).
+ */
+void test_signal_init(TestSignalGenerator *gen, TestSignalType type, float sampleRate);
+
+/**
+ * @brief Produce the next block of a test signal, continuing its phase.
+ *
+ * @param gen Pointer to the TestSignalGenerator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to produce.
+ */
+void test_signal_generate(TestSignalGenerator *gen, float *buffer, size_t length);
+
+/**
+ * @brief Feed the test signal samples elapsed since the previous frame into the input ring.
+ *
+ * @param audioData Pointer to the AudioData structure owning the ring.
+ * @param seconds Time elapsed since the previous call.
+ */
+void stream_test_signal(AudioData *audioData, float seconds);
+
 #ifdef UNIT_TESTING
 /**
  * @brief Get the precomputed window coefficients (for testing purposes).
@@ -0,0 +1,99 @@
+// latency.h
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LATENCY_HISTORY 64 // Callbacks kept for interval and jitter statistics
+
+/**
+ * @brief One invocation of the spectrum stream processor.
+ */
+typedef struct {
+    uint64_t time;            /**< Arrival time (ns, monotonic clock) */
+    uint64_t position;        /**< Ring sample position after the callback's samples */
+    uint32_t frames;          /**< Frames delivered */
+} CallbackRecord;
+
+/**
+ * @brief Callback timing and audio-to-draw latency readouts.
+ *
+ * The audio thread only appends CallbackRecords; every readout is derived on
+ * the render loop thread by latency_update.
+ */
+typedef struct {
+    float sampleRate;                          /**< Stream rate (Hz) */
+    size_t ringSize;                           /**< Analysis window length (samples) */
+
+    CallbackRecord callbacks[LATENCY_HISTORY]; /**< Recent callbacks, oldest overwritten */
+    uint64_t callbackCount;                    /**< Callbacks ever recorded; published with release */
+
+    uint64_t lastSpectrumPosition;             /**< Position of the previous spectrum */
+
+    bool valid;                                /**< Enough callbacks to report intervals */
+    float callbackFrames;                      /**< Mean frames per callback */
+    float intervalMs;                          /**< Mean time between callbacks */
+    float expectedIntervalMs;                  /**< Mean callback period implied by frame counts */
+    float jitterMs;                            /**< Standard deviation of the interval */
+    float maxDeviationMs;                      /**< Largest |interval - expected| */
+    uint64_t freshSamples;                     /**< Samples arrived since the previous spectrum */
+    float ringFill;                            /**< freshSamples / ringSize (over 1 = samples dropped) */
+    bool latencyValid;                         /**< The newest analysed sample came from a callback */
+    float arrivalToDrawMs;                     /**< Newest analysed sample arrival to draw */
+    float windowDelayMs;                       /**< Window centre behind its newest sample */
+} LatencyMonitor;
+
+/**
+ * @brief Initialise a latency monitor.
+ *
+ * @param monitor Pointer to the LatencyMonitor to initialise.
+ * @param sampleRate The sampling rate of the analysed stream (Hz).
+ * @param ringSize The number of samples in one analysis window.
+ */
+void latency_init(LatencyMonitor *monitor, float sampleRate, size_t ringSize);
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+uint64_t latency_now_ns(void);
+
+/**
+ * @brief Append one callback to the history. Audio thread only; lock- and
+ * allocation-free.
+ *
+ * @param monitor Pointer to the LatencyMonitor.
+ * @param time Arrival time of the callback (latency_now_ns).
+ * @param position Ring sample position after the callback's samples.
+ * @param frames Frames delivered by the callback.
+ */
+void latency_record_callback(LatencyMonitor *monitor, uint64_t time, uint64_t position, unsigned int frames);
+
+/**
+ * @brief Recompute the readouts for the spectrum about to be drawn.
+ *
+ * @param monitor Pointer to the LatencyMonitor.
+ * @param spectrumPosition Ring sample position the spectrum was taken at.
+ * @param drawTime Time the spectrum is submitted for display (ns).
+ */
+void latency_update(LatencyMonitor *monitor, uint64_t spectrumPosition, uint64_t drawTime);
+
+/**
+ * @brief Set the monitor fed by latency_note_callback.
+ *
+ * @param monitor Pointer to the LatencyMonitor, or NULL to disable.
+ */
+void set_latency_monitor(LatencyMonitor *monitor);
+
+/**
+ * @brief Record a callback on the monitor set by set_latency_monitor, timed
+ * now. Called from the spectrum stream processor.
+ *
+ * @param position Ring sample position after the callback's samples.
+ * @param frames Frames delivered by the callback.
+ */
+void latency_note_callback(uint64_t position, unsigned int frames);
+
+#endif // LATENCY_H
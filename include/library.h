@@ -0,0 +1,108 @@
+// library.h
+
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "string_arena.h"
+
+#define LIBRARY_NONE SIZE_MAX // No album
+#define LIBRARY_BORROWED 0x80000000u // Set on string offsets into the borrowed block
+
+/**
+ * @brief A song in the library.
+ */
+typedef struct {
+    uint32_t name;            /**< String offset of the file name; usually inside the path */
+    uint32_t path;            /**< String offset of the path */
+} LibrarySong;
+
+/**
+ * @brief An album: a directory of the media library and its songs, in the
+ * order they were added.
+ */
+typedef struct {
+    uint32_t name;            /**< String offset of the name */
+    uint32_t hash;            /**< Hash of the name, kept for rehashing */
+    LibrarySong *songs;
+    size_t songCount;
+    size_t songCapacity;
+    bool expanded;
+} LibraryAlbum;
+
+/**
+ * @brief The media library. Albums are stored contiguously in the order
+ * they were first seen and found by name through an open-addressing hash
+ * table. Strings live in one arena, or are referenced in place inside a
+ * borrowed block such as the mapped library index.
+ */
+typedef struct {
+    LibraryAlbum *albums;     /**< Indexed by album id */
+    size_t albumCount;
+    size_t albumCapacity;
+    uint32_t *slots;          /**< Album id + 1 per slot, 0 if empty; a power of two long */
+    size_t slotCount;
+    StringArena strings;
+    const char *borrowed;     /**< Block strings may point into instead of being copied; NULL if none */
+    size_t borrowedSize;
+} Library;
+
+/**
+ * @brief Initialise an empty library.
+ */
+void library_init(Library *library);
+
+/**
+ * @brief Free the library's storage.
+ */
+void library_free(Library *library);
+
+/**
+ * @brief Reference strings inside a block instead of copying them: names
+ * and paths passed from now on that lie in the block are stored as offsets
+ * into it. The block must outlive the library.
+ */
+void library_borrow(Library *library, const char *block, size_t size);
+
+/**
+ * @brief Look an album up by name. O(1) expected.
+ *
+ * @return Album id, or LIBRARY_NONE if there is no such album.
+ */
+size_t library_find_album(const Library *library, const char *name);
+
+/**
+ * @brief Look an album up by name, adding it if it is new.
+ *
+ * @return Album id, or LIBRARY_NONE if out of memory. Album pointers are
+ * invalidated; ids are not.
+ */
+size_t library_add_album(Library *library, const char *name);
+
+/**
+ * @brief Add a song to an album, creating the album if needed. Amortised O(1).
+ *
+ * @param library The library.
+ * @param album Album name.
+ * @param name Title to show.
+ * @param path File to play.
+ * @return False if out of memory.
+ */
+bool library_add_song(Library *library, const char *album, const char *name, const char *path);
+
+/**
+ * @brief Total number of songs over all albums.
+ */
+size_t library_song_count(const Library *library);
+
+/**
+ * @brief String at an offset stored in an album or song.
+ */
+static inline const char* library_string(const Library *library, uint32_t offset) {
+    if (offset & LIBRARY_BORROWED) return library->borrowed + (offset & ~LIBRARY_BORROWED);
+    return string_arena_get(&library->strings, offset);
+}
+
+#endif // LIBRARY_H
@@ -0,0 +1,67 @@
+// library_index.h
+
+#ifndef LIBRARY_INDEX_H
+#define LIBRARY_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "library_scan.h"
+
+#define LIBRARY_INDEX_PATH "./bragibeats.index" // Default location, next to ./media
+#define LIBRARY_INDEX_VERSION 2
+
+/**
+ * @brief What loading the library through the index took.
+ */
+typedef struct {
+    uint64_t directories;   /**< Directories in the library */
+    uint64_t songs;         /**< Songs reported */
+    uint64_t rescanned;     /**< Directories listed again: changed, new, or all of them on a rebuild */
+    bool rebuilt;           /**< The index was missing, stale or damaged; the whole tree was scanned */
+    bool written;           /**< A new index was saved */
+    LibraryScanStats scan;  /**< Totals over the directory listings that were needed */
+    double seconds;         /**< Wall time, including validation and saving */
+} LibraryIndexStats;
+
+/**
+ * @brief An index left mapped by library_index_load, so that what its songs
+ * point into stays valid.
+ */
+typedef struct {
+    void *data;
+    size_t size;
+} LibraryIndexMapping;
+
+/**
+ * @brief Report every song of a media directory, from the on-disk index
+ * where it is still valid.
+ *
+ * The index is memory-mapped and checked one directory at a time: a
+ * directory whose modification time is unchanged has the same entries, so
+ * its songs come from the index and it is not listed. Changed directories
+ * are listed again, new ones scanned in full, and vanished ones dropped. If
+ * anything differed, the index is rewritten.
+ *
+ * Songs of unchanged directories are reported with strings inside the
+ * mapping and nothing is copied for them, unless the index is rewritten.
+ *
+ * @param indexPath Index file; created if missing.
+ * @param root Media directory.
+ * @param visitor Receives the songs; only its song and strings callbacks
+ * and context are used.
+ * @param stats Receives counts and timing; may be NULL.
+ * @param mapping If not NULL and the visitor has a strings callback,
+ * receives the index mapping, which then outlives the call; release it
+ * with library_index_unmap. Empty if there was no valid index.
+ * @return False if the media directory could not be opened.
+ */
+bool library_index_load(const char *indexPath, const char *root, const LibraryScanVisitor *visitor,
+                        LibraryIndexStats *stats, LibraryIndexMapping *mapping);
+
+/**
+ * @brief Release a mapping kept by library_index_load. Safe on an empty one.
+ */
+void library_index_unmap(LibraryIndexMapping *mapping);
+
+#endif // LIBRARY_INDEX_H
@@ -0,0 +1,74 @@
+// library_scan.h
+
+#ifndef LIBRARY_SCAN_H
+#define LIBRARY_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LIBRARY_SCAN_WORKERS 8      // Directory walkers; I/O bound, so more than cores pays off on network shares
+#define LIBRARY_SCAN_PATH_MAX 4096  // Longer paths are skipped with a warning
+
+struct stat;
+
+/**
+ * @brief A song found by a scan.
+ */
+typedef struct {
+    const char *album;      /**< Name of the directory holding the song; NULL in the library root */
+    const char *name;       /**< File name */
+    const char *path;       /**< Path, starting with the scanned directory */
+    uint64_t size;          /**< File size (bytes) */
+    int64_t modified;       /**< Modification time (ns since the epoch) */
+} LibraryScanSong;
+
+/**
+ * @brief What a scan reports, and to whom. Calls are serialised, so the
+ * callbacks need no locking of their own; unused ones may be NULL.
+ */
+typedef struct {
+    /** Once per song, in no particular order */
+    void (*song)(void *context, const LibraryScanSong *song);
+    /** Once per directory listed, with its modification time taken before listing */
+    void (*directory)(void *context, const char *path, int64_t modified);
+    /** Non-recursive scans: once per subdirectory, instead of descending into it */
+    void (*subdirectory)(void *context, const char *path);
+    /** Index loads that keep the index mapped: once, before any song, the
+     *  block that songs from the index point into; it stays valid until
+     *  library_index_unmap */
+    void (*strings)(void *context, const char *block, size_t size);
+    void *context;
+    const char *rootAlbum;  /**< Album of the songs directly in the scanned directory */
+} LibraryScanVisitor;
+
+/**
+ * @brief What a scan went through, for throughput reporting.
+ */
+typedef struct {
+    uint64_t directories;   /**< Directories listed, including the root */
+    uint64_t files;         /**< Non-directory entries seen */
+    uint64_t songs;         /**< Files passed to the visitor */
+    double seconds;         /**< Wall time of the scan */
+} LibraryScanStats;
+
+/**
+ * @brief Walk a directory tree in parallel and report every .wav and .mp3
+ * file in it. Blocks until the whole tree has been listed.
+ *
+ * @param root Directory to scan.
+ * @param visitor Receives songs and directories.
+ * @param recursive False to list the root alone, on the calling thread.
+ * @param stats Receives counts and timing, zero if the scan could not
+ * start; may be NULL.
+ * @return False if the root could not be opened.
+ */
+bool library_scan(const char *root, const LibraryScanVisitor *visitor, bool recursive, LibraryScanStats *stats);
+
+/**
+ * @brief Modification time of a stat result in nanoseconds since the epoch,
+ * as reported to visitors.
+ */
+int64_t library_scan_modified(const struct stat *st);
+
+#endif // LIBRARY_SCAN_H
@@ -0,0 +1,52 @@
+// loader.h
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdbool.h>
+#include "player.h"
+
+#define LOADER_SLOTS 4 // Decodes queued or finished but not yet collected
+
+typedef enum {
+    LOADER_IDLE,      /**< Never requested, or already collected */
+    LOADER_PENDING,   /**< Queued or decoding */
+    LOADER_READY,     /**< Decoded; ownership passed to the caller */
+    LOADER_FAILED     /**< The file could not be decoded */
+} LoaderStatus;
+
+/**
+ * @brief Start the background decode thread.
+ */
+void loader_init(void);
+
+/**
+ * @brief Stop the decode thread, waiting for a decode in progress, and free
+ * every uncollected track.
+ */
+void loader_shutdown(void);
+
+/**
+ * @brief Queue a file for decoding. Requests for a path already queued or
+ * decoded are merged.
+ *
+ * @param path File to decode.
+ * @param urgent True when playback is waiting for it; urgent requests are
+ * decoded before prefetches.
+ * @return False if every slot is busy decoding.
+ *
+ * A finished but uncollected decode is moved to the track cache to make
+ * room when needed.
+ */
+bool loader_request(const char *path, bool urgent);
+
+/**
+ * @brief Check on a requested file.
+ *
+ * @param path File passed to loader_request.
+ * @param track Receives the decoded track on LOADER_READY.
+ * @return Status of the request. READY and FAILED are reported once.
+ */
+LoaderStatus loader_poll(const char *path, PlayerTrack **track);
+
+#endif // LOADER_H
@@ -0,0 +1,111 @@
+// loudness.h
+
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LOUDNESS_CHANNELS 2          // The stream tap is interleaved stereo
+#define LOUDNESS_SUBBLOCKS 30        // 3 s short-term window in 100 ms steps
+#define LOUDNESS_MOMENTARY_BLOCKS 4  // 400 ms momentary / gating block
+#define LOUDNESS_HISTOGRAM_BINS 1000 // -70..+30 LUFS at 0.1 LU resolution
+#define TRUE_PEAK_PHASES 4           // 4x oversampling
+#define TRUE_PEAK_TAPS 12            // Taps per polyphase branch
+
+/**
+ * @brief Second-order IIR section in transposed direct form II.
+ */
+typedef struct {
+    double b0, b1, b2; /**< Feed-forward coefficients */
+    double a1, a2;     /**< Feedback coefficients (a0 normalised to 1) */
+    double z1, z2;     /**< Filter state */
+} Biquad;
+
+/**
+ * @brief EBU R128 / ITU-R BS.1770 loudness and true-peak meter.
+ *
+ * All storage is inline so the meter can run inside the audio callback
+ * without allocating. Readouts are in LUFS and dBTP and are updated every
+ * 100 ms sub-block.
+ */
+typedef struct {
+    float sampleRate;                                  /**< Input sampling rate (Hz) */
+    Biquad shelf[LOUDNESS_CHANNELS];                   /**< K-weighting stage 1: high shelf */
+    Biquad highpass[LOUDNESS_CHANNELS];                /**< K-weighting stage 2: RLB high-pass */
+
+    size_t subBlockLength;                             /**< Frames per 100 ms sub-block */
+    size_t subBlockFill;                               /**< Frames accumulated in the current sub-block */
+    double subBlockEnergy;                             /**< Weighted sum of squares in the current sub-block */
+    double subBlocks[LOUDNESS_SUBBLOCKS];              /**< Mean-square energy of recent sub-blocks */
+    size_t subBlockIndex;                              /**< Next write position in subBlocks */
+    size_t subBlockCount;                              /**< Number of valid entries in subBlocks */
+    unsigned int histogram[LOUDNESS_HISTOGRAM_BINS];   /**< Gating-block loudness histogram for integrated loudness */
+
+    float tpHistory[LOUDNESS_CHANNELS][2 * TRUE_PEAK_TAPS]; /**< Mirrored FIR history for the oversampler */
+    size_t tpPosition;                                 /**< Newest sample position in tpHistory */
+    float tpBlockPeak;                                 /**< Linear true peak within the current sub-block */
+
+    float momentary;    /**< Momentary loudness, 400 ms window (LUFS) */
+    float shortTerm;    /**< Short-term loudness, 3 s window (LUFS) */
+    float integrated;   /**< Gated integrated loudness since the last reset (LUFS) */
+    float truePeak;     /**< True peak of the last sub-block (dBTP) */
+    float maxTruePeak;  /**< Highest true peak since the last reset (dBTP) */
+
+    volatile bool resetRequested; /**< Set by the UI thread, honoured on the audio thread */
+} LoudnessMeter;
+
+/**
+ * @brief Initialise the meter and design the K-weighting filters for a rate.
+ *
+ * @param meter Pointer to the LoudnessMeter to initialise.
+ * @param sampleRate The sampling rate of the incoming audio (Hz).
+ */
+void loudness_init(LoudnessMeter *meter, float sampleRate);
+
+/**
+ * @brief Clear filter state, history and all readouts (e.g. on track change).
+ *
+ * @param meter Pointer to the LoudnessMeter to reset.
+ */
+void loudness_reset(LoudnessMeter *meter);
+
+/**
+ * @brief Ask the audio thread to reset the meter before its next block.
+ *
+ * @param meter Pointer to the LoudnessMeter to reset.
+ */
+void loudness_request_reset(LoudnessMeter *meter);
+
+/**
+ * @brief Feed interleaved stereo frames through the meter.
+ *
+ * @param meter Pointer to the LoudnessMeter.
+ * @param frames Interleaved stereo float samples.
+ * @param frameCount The number of frames in the buffer.
+ */
+void loudness_process(LoudnessMeter *meter, const float *frames, size_t frameCount);
+
+/**
+ * @brief Set the meter driven by loudness_callback.
+ *
+ * @param meter Pointer to the LoudnessMeter, or NULL to disable metering.
+ */
+void set_loudness_meter(LoudnessMeter *meter);
+
+/**
+ * @brief Audio stream processor that feeds the meter set by set_loudness_meter.
+ *
+ * @param bufferData Pointer to the buffer containing audio frames.
+ * @param frames The number of frames in the buffer.
+ */
+void loudness_callback(void *bufferData, unsigned int frames);
+
+/**
+ * @brief Print the current readouts as a single log line on stdout.
+ *
+ * @param meter Pointer to the LoudnessMeter to report.
+ */
+void loudness_print(const LoudnessMeter *meter);
+
+#endif // LOUDNESS_H
@@ -0,0 +1,69 @@
+// noise.h
+
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NOISE_LANES 8          // Independent xoshiro128+ streams filled in parallel
+#define NOISE_PINK_ROWS 16     // Voss-McCartney octave rows
+#define NOISE_DEFAULT_SEED 0x42524147u
+
+/**
+ * @brief Seeded, reproducible noise source.
+ *
+ * White noise comes from NOISE_LANES xoshiro128+ generators stepped together
+ * with 4-wide vector instructions; every lane starts 2^64 steps after the
+ * previous one so the streams never overlap. Pink and brown noise are shaped
+ * from the white stream. The same seed gives the same samples on every
+ * platform, however the output is split into calls.
+ */
+typedef struct {
+    uint32_t state[4][NOISE_LANES];   /**< xoshiro128+ state, word-major so each word loads as a vector */
+    float spare[NOISE_LANES];         /**< Last step's samples a shorter call did not use */
+    uint32_t spareCount;              /**< Unused samples at the end of spare */
+    float pinkRows[NOISE_PINK_ROWS];  /**< Current value of each Voss-McCartney row */
+    float pinkHigh;                   /**< Sum of pinkRows above row 2 */
+    uint32_t pinkCounter;             /**< Sample counter selecting the row to refresh */
+    float brown;                      /**< Brown noise output before the current group of four */
+    float brownPartial;               /**< Input integrated since that group started */
+    uint32_t brownPhase;              /**< Samples of the current group already produced */
+} NoiseGenerator;
+
+/**
+ * @brief Seed a noise generator and clear its shaping state.
+ *
+ * @param gen Pointer to the NoiseGenerator to seed.
+ * @param seed Any 64-bit value; equal seeds give equal output.
+ */
+void noise_seed(NoiseGenerator *gen, uint64_t seed);
+
+/**
+ * @brief Fill a buffer with uniform white noise in [-1, 1).
+ *
+ * @param gen Pointer to the NoiseGenerator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to generate.
+ */
+void noise_white(NoiseGenerator *gen, float *buffer, size_t length);
+
+/**
+ * @brief Fill a buffer with pink (-3 dB/octave) noise in [-1, 1].
+ *
+ * @param gen Pointer to the NoiseGenerator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to generate.
+ */
+void noise_pink(NoiseGenerator *gen, float *buffer, size_t length);
+
+/**
+ * @brief Fill a buffer with brown (-6 dB/octave) noise in [-1, 1].
+ *
+ * @param gen Pointer to the NoiseGenerator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to generate.
+ */
+void noise_brown(NoiseGenerator *gen, float *buffer, size_t length);
+
+#endif // NOISE_H
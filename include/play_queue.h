@@ -0,0 +1,118 @@
+// play_queue.h
+
+#ifndef PLAY_QUEUE_H
+#define PLAY_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "player.h"
+#include "string_arena.h"
+
+#define PLAY_QUEUE_NONE SIZE_MAX // No entry / no position
+
+typedef enum {
+    SONG_PROBING,             // Dropped file not checked yet; shown as loading
+    SONG_PLAYABLE,
+    SONG_FAILED               // Not audio, or decoding failed; not retried by prefetch
+} SongStatus;
+
+/**
+ * @brief A queued song: where to find it and what is known about it.
+ * Decoded audio is attached only to the current song and its successor.
+ */
+typedef struct {
+    uint32_t title;           /**< Offset of the title in the queue's arena */
+    uint32_t path;            /**< Offset of the path in the queue's arena */
+    PlayerTrack *track;       /**< Decoded audio; only held near the play position */
+    SongStatus status;
+    unsigned int sampleRate;  /**< Format of the file, once it has been decoded (Hz) */
+    unsigned int sampleBits;
+} QueueEntry;
+
+/**
+ * @brief The play queue. Entries are stored contiguously in the order they
+ * were added, so an entry id never changes; the play order is a separate
+ * permutation of ids, which is all reordering and shuffling touch.
+ */
+typedef struct {
+    QueueEntry *entries;      /**< Indexed by entry id */
+    uint32_t *order;          /**< Play position -> entry id */
+    size_t count;
+    size_t capacity;
+    size_t current;           /**< Play position of the current song, or PLAY_QUEUE_NONE */
+    StringArena strings;
+} PlayQueue;
+
+/**
+ * @brief Initialise an empty queue.
+ */
+void play_queue_init(PlayQueue *queue);
+
+/**
+ * @brief Free the queue's storage. Tracks still attached are not freed.
+ */
+void play_queue_free(PlayQueue *queue);
+
+/**
+ * @brief Add a song at the end of the play order. Amortised O(1).
+ *
+ * @param queue The queue.
+ * @param title Title to show.
+ * @param path File to play.
+ * @return Id of the new entry, or PLAY_QUEUE_NONE if out of memory.
+ *
+ * Entry pointers are invalidated; ids are not.
+ */
+size_t play_queue_append(PlayQueue *queue, const char *title, const char *path);
+
+/**
+ * @brief Entry by id.
+ */
+static inline QueueEntry* play_queue_entry(PlayQueue *queue, size_t id) {
+    return &queue->entries[id];
+}
+
+/**
+ * @brief Entry at a play position, or NULL past either end. O(1).
+ */
+static inline QueueEntry* play_queue_at(PlayQueue *queue, size_t position) {
+    return position < queue->count ? &queue->entries[queue->order[position]] : NULL;
+}
+
+/**
+ * @brief Title of an entry.
+ */
+static inline const char* play_queue_title(const PlayQueue *queue, const QueueEntry *entry) {
+    return string_arena_get(&queue->strings, entry->title);
+}
+
+/**
+ * @brief Path of an entry.
+ */
+static inline const char* play_queue_path(const PlayQueue *queue, const QueueEntry *entry) {
+    return string_arena_get(&queue->strings, entry->path);
+}
+
+/**
+ * @brief Move the song at one play position to another, shifting those in
+ * between. The current song stays current.
+ *
+ * @param queue The queue.
+ * @param from Position of the song to move.
+ * @param to Position it ends up at.
+ */
+void play_queue_move(PlayQueue *queue, size_t from, size_t to);
+
+/**
+ * @brief Shuffle the songs after the current one (all of them if none is
+ * current).
+ *
+ * @param queue The queue.
+ * @param seed Seed of the permutation; the same seed gives the same order.
+ * @return False if fewer than two songs follow the current one, so there
+ * was nothing to reorder.
+ */
+bool play_queue_shuffle(PlayQueue *queue, uint64_t seed);
+
+#endif // PLAY_QUEUE_H
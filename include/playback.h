@@ -5,8 +5,8 @@
 
 #include <raylib.h>
 #include <stdbool.h>
-
-#define MAX_SONGS 100
+#include "player.h"
+#include "play_queue.h"
 
 typedef enum {
     VISUALIZER_BAR_CHART,
@@ -14,25 +14,8 @@ typedef enum {
     VISUALIZER_3D_TIME_TUNNEL
 } VisualizerType;
 
-typedef struct SongNode {
-    Music song;
-    char title[256];
-    char fullPath[1024];
-    struct SongNode* next;
-    struct SongNode* prev;
-} SongNode;
-
-typedef struct {
-    Music songs[MAX_SONGS];
-    char titles[MAX_SONGS][256];
-    int front, rear;
-} SongQueue;
-
 // External variables
-extern SongNode* currentSong;
-extern SongNode* head;
-extern SongNode* tail;
-extern SongQueue songQueue;
+extern PlayQueue playQueue;
 extern bool isPlaying;
 extern VisualizerType currentVisualizer;
 
@@ -42,8 +25,11 @@ void PlayCurrentSong(void);
 void PlayPause(void);
 void SkipForward(void);
 void SkipBackward(void);
-void playSongNode(SongNode* node);
-bool enqueueTitle(const char* title);
-void enqueueSong(Music song, const char* title, const char* fullPath);
+void ShuffleQueue(void);
+void playQueuePosition(size_t position);
+void attachTrack(QueueEntry* entry, PlayerTrack* track);
+QueueEntry* currentEntry(void);
+QueueEntry* nextEntry(void);
+size_t enqueueSong(const char* title, const char* fullPath);
 
 #endif // PLAYBACK_H
@@ -0,0 +1,267 @@
+// player.h
+
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <raylib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "wav_map.h"
+#include "resample.h"
+
+#define PLAYER_CHANNELS 2            // Output is interleaved stereo
+#define PLAYER_PREFETCH_SECONDS 15.0f // Decode the next track once this close to the end
+#define PLAYER_REQUESTS 16           // Request slots cycled by the render loop
+#define PLAYER_RETIRED_TRACKS 32     // Released tracks awaiting the player threads
+#define PLAYER_RING_FRAMES 8192      // PCM decoded ahead of the device (~186 ms)
+#define PLAYER_MARKERS 64            // Track segments buffered in the ring
+#define PLAYER_DECODE_PERIOD_MS 5    // Decode thread wake-up interval
+#define PLAYER_MAX_CROSSFADE_SECONDS 10.0f // Kept below the prefetch lead
+#define PLAYER_CROSSFADE_BLOCK 256   // Frames between exact gain evaluations
+#define PLAYER_DECODE_CHUNK 1024     // Frames read from a streaming decoder per call
+
+// Rate of the output stream (Hz); set it to the audio device's so raylib
+// converts nothing after the decode thread: make OUTPUT_RATE=48000
+#ifndef PLAYER_OUTPUT_RATE
+#define PLAYER_OUTPUT_RATE 44100
+#endif
+
+// Filter used for files at other rates; make RESAMPLE=FAST|MEDIUM|BEST
+#ifndef PLAYER_RESAMPLE_QUALITY
+#define PLAYER_RESAMPLE_QUALITY RESAMPLE_MEDIUM
+#endif
+
+typedef struct PlayerStream PlayerStream;
+
+/**
+ * @brief A track ready for playback at the output rate. Frames come from a
+ * PCM WAV's file mapping, from a streaming MP3 or WAV decoder, or, for
+ * anything else, from interleaved 16-bit stereo decoded in full; sources
+ * at another rate are resampled as they are read.
+ */
+typedef struct PlayerTrack {
+    Wave wave;                /**< Decoded PCM, when neither mapped nor streamed */
+    WavMap map;               /**< Mapped file, when mapped is true */
+    bool mapped;
+    const int16_t *frames;    /**< Decoded interleaved stereo samples, or NULL */
+    PlayerStream *stream;     /**< Decoder, resampler and prefetched head; NULL when read in place */
+    uint64_t frameCount;      /**< Frames in the track, at the output rate */
+    unsigned int sourceRate;  /**< Sample rate of the file (Hz) */
+    unsigned int sourceBits;  /**< Sample size of the file (bits) */
+    int64_t modified;         /**< File modification time at load, for the cache */
+    uint64_t fileSize;        /**< File size at load, for the cache */
+    char path[1024];
+} PlayerTrack;
+
+/**
+ * @brief Open a file as a PlayerTrack. PCM WAVs are mapped, MP3s and other
+ * WAVs get a streaming decoder, and anything else is decoded in full;
+ * files at other rates go through the polyphase resampler. Only the first
+ * PLAYER_RING_FRAMES frames are converted here, the rest on the decode
+ * thread as playback reaches them. Blocking; meant for the loader thread.
+ *
+ * @param path Path of a WAV or MP3 file.
+ * @return The track, or NULL on failure.
+ */
+PlayerTrack* player_load_track(const char *path);
+
+/**
+ * @brief Free a track that the audio thread has never seen, or has
+ * finished with (see player_release).
+ *
+ * @param track Track to free; NULL is ignored.
+ */
+void player_unload_track(PlayerTrack *track);
+
+/**
+ * @brief Heap a track holds, for the track cache's budget.
+ */
+size_t player_track_bytes(const PlayerTrack *track);
+
+/**
+ * @brief Set the resampler quality for tracks loaded from now on.
+ */
+void player_set_resample_quality(ResampleQuality quality);
+
+/**
+ * @brief Resampler quality used by player_load_track.
+ */
+ResampleQuality player_resample_quality(void);
+
+/**
+ * @brief Rate the output stream runs at, and so the rate stream processors
+ * see (Hz): PLAYER_OUTPUT_RATE.
+ */
+unsigned int player_output_rate(void);
+
+/**
+ * @brief Open the output stream and attach the given stream processors.
+ * Requires an initialised audio device.
+ *
+ * @param processors Processors to attach, in order; NULL-terminated.
+ */
+void player_init(AudioCallback *processors);
+
+/**
+ * @brief Close the output stream and free every track still held.
+ */
+void player_shutdown(void);
+
+/**
+ * @brief Run one pass of the decode thread: apply the latest player_play
+ * request and top the PCM ring up with frames of the current track.
+ *
+ * @return Frames written to the ring.
+ *
+ * When the current track ends, decoding continues with the track set by
+ * player_set_next from the very next ring frame, so the transition lands on
+ * the sample. With a crossfade set, the successor instead starts that long
+ * before the end and the two are mixed. Called by the decode thread started
+ * in player_init.
+ */
+size_t player_decode(void);
+
+/**
+ * @brief Fill an output buffer from the PCM ring. This is the output
+ * stream's callback; lock- and allocation-free, and never decodes.
+ *
+ * @param out Interleaved stereo float frames to fill.
+ * @param frames Number of frames requested.
+ *
+ * Frames the decode thread has not produced yet are output as silence.
+ */
+void player_mix(float *out, unsigned int frames);
+
+/**
+ * @brief Switch playback to a track. Audio of the previous track still in
+ * the PCM ring is dropped. Clears the track queued by player_set_next.
+ *
+ * @param track Track to play, or NULL to stop.
+ * @param frame First frame to play.
+ */
+void player_play(PlayerTrack *track, uint64_t frame);
+
+/**
+ * @brief Queue the track that follows the current one without a gap.
+ *
+ * @param track The successor, or NULL to end playback with the current track.
+ */
+void player_set_next(PlayerTrack *track);
+
+/**
+ * @brief Set how long consecutive tracks overlap.
+ *
+ * @param seconds Crossfade length, clamped to [0, PLAYER_MAX_CROSSFADE_SECONDS];
+ * 0 plays tracks back to back. Takes effect from the next transition.
+ */
+void player_set_crossfade(float seconds);
+
+/**
+ * @brief Current crossfade length (seconds).
+ */
+float player_crossfade_seconds(void);
+
+/**
+ * @brief Move the crossfade to the next longer preset: off, 2 s, 5 s, then
+ * PLAYER_MAX_CROSSFADE_SECONDS, and back to off.
+ *
+ * @return The new crossfade length (seconds).
+ */
+float player_step_crossfade(void);
+
+/**
+ * @brief Mix the tail of one track into the start of the next with
+ * equal-power gains.
+ *
+ * @param incoming Interleaved stereo frames of the incoming track; receives
+ * the mix.
+ * @param outgoing As many frames of the outgoing track.
+ * @param frames Number of frames.
+ * @param position Frames of the crossfade before these ones.
+ * @param length Length of the whole crossfade (frames).
+ */
+void player_crossfade(float *incoming, const float *outgoing, size_t frames, uint64_t position, uint64_t length);
+
+/**
+ * @brief Pause or resume the output stream.
+ *
+ * @param paused True to pause.
+ */
+void player_set_paused(bool paused);
+
+/**
+ * @brief Seek within the playing track.
+ *
+ * @param seconds Position from the start of the track.
+ */
+void player_seek(float seconds);
+
+/**
+ * @brief Seek while the user drags through the playing track. Positions
+ * arriving faster than the device consumes audio are coalesced, so only
+ * the latest one is played each audio period.
+ *
+ * @param seconds Position from the start of the track.
+ * @param final True when the drag ends; the position is then always applied.
+ *
+ * Call every frame while dragging, with the current position: a position
+ * held back is sent by a later call.
+ */
+void player_scrub(float seconds, bool final);
+
+/**
+ * @brief Hand a track back to the player. player_reclaim passes it on to the
+ * track cache once neither the decode thread nor the audio thread can
+ * reach it.
+ *
+ * @param track Track released by the render loop; NULL is ignored.
+ */
+void player_release(PlayerTrack *track);
+
+/**
+ * @brief Move released tracks both threads are done with into the track
+ * cache. Called once per frame by the render loop.
+ */
+void player_reclaim(void);
+
+/**
+ * @brief The track the device has reached.
+ */
+PlayerTrack* player_playing_track(void);
+
+/**
+ * @brief True once the playing track ended with no successor queued.
+ */
+bool player_finished(void);
+
+/**
+ * @brief Position of the device in the playing track (seconds).
+ */
+float player_time_played(void);
+
+/**
+ * @brief Length of the playing track (seconds).
+ */
+float player_time_length(void);
+
+/**
+ * @brief Audio decoded ahead of the device (ms).
+ */
+float player_buffered_ms(void);
+
+/**
+ * @brief Audio callbacks that found the ring short in the middle of a track.
+ */
+uint64_t player_underruns(void);
+
+#ifdef UNIT_TESTING
+/**
+ * @brief Seek points bound to a track's MP3 decoder (for testing purposes).
+ *
+ * @return The number of points, 0 for a track without an MP3 decoder.
+ */
+uint32_t player_track_seek_points(const PlayerTrack *track);
+#endif
+
+#endif // PLAYER_H
@@ -0,0 +1,54 @@
+// probe.h
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdbool.h>
+
+#define PROBE_WORKERS 2     // Threads checking dropped files
+#define PROBE_QUEUE 4096    // Probes submitted but not yet collected
+
+/**
+ * @brief Outcome of one probe.
+ */
+typedef struct {
+    void *tag;              /**< Tag passed to probe_submit */
+    bool playable;          /**< The file looks like audio the player decodes */
+} ProbeResult;
+
+/**
+ * @brief Check a file's header for a format the player can decode. Blocking.
+ *
+ * @param path File to check.
+ * @return True for a RIFF/WAVE file or an MP3 (ID3 tag or frame sync).
+ */
+bool probe_audio_file(const char *path);
+
+/**
+ * @brief Start the probe workers.
+ */
+void probe_init(void);
+
+/**
+ * @brief Stop the probe workers, dropping probes not yet run or collected.
+ */
+void probe_shutdown(void);
+
+/**
+ * @brief Queue a file to be probed in the background.
+ *
+ * @param path File to probe.
+ * @param tag Returned with the result to identify the request.
+ * @return False if the queue is full or the workers are not running.
+ */
+bool probe_submit(const char *path, void *tag);
+
+/**
+ * @brief Take the oldest probe if it has finished. Never blocks.
+ *
+ * @param result Receives the result.
+ * @return False if the oldest probe is still pending, or none is queued.
+ */
+bool probe_collect(ProbeResult *result);
+
+#endif // PROBE_H
@@ -0,0 +1,130 @@
+// profiler.h
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PROFILER_HISTORY 240 // Rolling window: 4 s of frames at 60 FPS
+#define PROFILER_TRACE_FRAMES 300 // Frames written by profiler_dump_trace
+#define PROFILER_MAIN_EVENTS 16384 // Trace ring of the render loop thread
+#define PROFILER_AUDIO_EVENTS 4096 // Trace ring of the audio callback thread
+
+/**
+ * @brief Timed stages of the main loop, the analysis and DrawUI, followed by
+ * the audio callback thread.
+ *
+ * Visualizers get one stage each so a slow one stands out; a stage that did
+ * not run in a frame contributes no sample. Audio thread stages are only
+ * recorded in the trace, not in the per-frame statistics.
+ */
+typedef enum {
+    PROFILE_FRAME,            /**< Whole iteration of the main loop */
+    PROFILE_FILE_DROP,        /**< Loading dropped files */
+    PROFILE_INPUT,            /**< HandleInput */
+    PROFILE_PLAYBACK,         /**< UpdatePlaybackState */
+    PROFILE_ANALYSIS,         /**< HandleAnalysisInput + ProcessFFT */
+    PROFILE_ANALYSIS_WINDOW,  /**< Ring copy and window function */
+    PROFILE_ANALYSIS_FFT,     /**< Single-resolution FFT */
+    PROFILE_ANALYSIS_BANDS,   /**< Band accumulation */
+    PROFILE_ANALYSIS_MULTIRES,/**< Multi-resolution transforms and bands */
+    PROFILE_ANALYSIS_SCALE,   /**< dB scaling, normalisation and smoothing */
+    PROFILE_DRAW_UI,          /**< DrawUI as a whole */
+    PROFILE_UI_PROGRESS,      /**< Progress bar and sample info */
+    PROFILE_VIS_BAR_CHART,    /**< Bar chart visualizer */
+    PROFILE_VIS_IRIDESCENT,   /**< Iridescent visualizer */
+    PROFILE_VIS_TIME_TUNNEL,  /**< 3D time tunnel visualizer */
+    PROFILE_UI_QUEUE,         /**< Song queue panel */
+    PROFILE_UI_CONTROLS,      /**< Playback controls */
+    PROFILE_PRESENT,          /**< EndDrawing: buffer swap and frame pacing */
+    PROFILE_AUDIO_CALLBACK,   /**< Spectrum tap (callback) */
+    PROFILE_AUDIO_LOUDNESS,   /**< Loudness meter tap */
+    PROFILE_STAGE_COUNT
+} ProfileStage;
+
+// Stages below this run on the render loop thread
+#define PROFILE_FRAME_STAGE_COUNT PROFILE_AUDIO_CALLBACK
+
+/**
+ * @brief Rolling statistics of one stage, in milliseconds.
+ */
+typedef struct {
+    float min;
+    float avg;
+    float p99;
+    float last;
+    size_t samples;           /**< Frames in the window where the stage ran */
+} ProfileStats;
+
+#ifdef ENABLE_PROFILER
+
+#define PROFILE_BEGIN(stage) profiler_begin(stage)
+#define PROFILE_END(stage) profiler_end(stage)
+#define PROFILE_FRAME_END() profiler_end_frame()
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+uint64_t profiler_now_ns(void);
+
+/**
+ * @brief Start timing a stage.
+ *
+ * @param stage The stage to time.
+ */
+void profiler_begin(ProfileStage stage);
+
+/**
+ * @brief Stop timing a stage and record it in the trace ring of its thread.
+ * Repeated begin/end pairs within one frame accumulate.
+ *
+ * Audio thread stages may be timed from the audio callback: recording only
+ * writes into preallocated storage.
+ *
+ * @param stage The stage started with profiler_begin.
+ */
+void profiler_end(ProfileStage stage);
+
+/**
+ * @brief Commit this frame's stage times to the rolling history.
+ */
+void profiler_end_frame(void);
+
+/**
+ * @brief Get the rolling statistics of a stage.
+ *
+ * Percentiles are recomputed a few times per second rather than every call.
+ *
+ * @param stage The stage to query.
+ * @return Statistics over the last PROFILER_HISTORY frames; all zero for
+ * audio thread stages.
+ */
+ProfileStats profiler_stats(ProfileStage stage);
+
+/**
+ * @brief Get the display name of a stage.
+ */
+const char* profiler_stage_name(ProfileStage stage);
+
+/**
+ * @brief Write the last PROFILER_TRACE_FRAMES frames of both threads as
+ * Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Call from the render loop thread; the audio thread may keep recording.
+ *
+ * @param path The output file path.
+ * @return true on success.
+ */
+bool profiler_dump_trace(const char *path);
+
+#else
+
+#define PROFILE_BEGIN(stage) ((void)0)
+#define PROFILE_END(stage) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
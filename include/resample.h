@@ -0,0 +1,120 @@
+// resample.h
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RESAMPLE_MAX_PHASES 1024   // Rate pairs needing more filter phases are refused
+#define RESAMPLE_BLOCK 4096        // Output frames produced per pass of resampler_convert
+
+typedef enum {
+    RESAMPLE_FAST,                 // 32 taps, 60 dB stopband
+    RESAMPLE_MEDIUM,               // 64 taps, 90 dB stopband
+    RESAMPLE_BEST,                 // 128 taps, 120 dB stopband
+    RESAMPLE_QUALITY_COUNT
+} ResampleQuality;
+
+/**
+ * @brief Polyphase windowed-sinc converter between two sample rates.
+ *
+ * The rates are reduced to up/down by their common divisor; output frame k
+ * sits at input position k * down / up, and is the dot product of the taps
+ * input frames around it with the filter phase of its fractional part.
+ * Tap counts are for upsampling; when downsampling they grow with the
+ * ratio so the cutoff can move down without widening the transition band.
+ */
+typedef struct {
+    unsigned int inRate;
+    unsigned int outRate;
+    unsigned int up;               /**< Filter phases */
+    unsigned int down;             /**< Input frames advanced per up output frames */
+    unsigned int taps;             /**< Filter length per phase, a multiple of 8 */
+    float *coefficients;           /**< up rows of taps, each summing to 1 */
+} Resampler;
+
+/**
+ * @brief Interleaved input source for resampler_convert.
+ *
+ * @param context Context passed to resampler_convert.
+ * @param frame First frame to read; always inside the input.
+ * @param out Receives frames * channels samples.
+ * @param frames Number of frames to read.
+ */
+typedef void (*ResampleRead)(void *context, uint64_t frame, float *out, size_t frames);
+
+/**
+ * @brief Interleaved output sink for resampler_convert.
+ *
+ * @param context Context passed to resampler_convert.
+ * @param frame Output frame of the first sample.
+ * @param in Converted frames * channels samples.
+ * @param frames Number of frames converted.
+ */
+typedef void (*ResampleWrite)(void *context, uint64_t frame, const float *in, size_t frames);
+
+/**
+ * @brief Name of a quality level ("fast", "medium", "best").
+ */
+const char* resample_quality_name(ResampleQuality quality);
+
+/**
+ * @brief Build the filter bank for a rate pair.
+ *
+ * @param resampler Resampler to initialise.
+ * @param inRate Input sample rate (Hz).
+ * @param outRate Output sample rate (Hz).
+ * @param quality Filter length and stopband attenuation.
+ * @return False if the pair needs more than RESAMPLE_MAX_PHASES phases or
+ * memory runs out; the resampler is then left empty.
+ */
+bool resampler_init(Resampler *resampler, unsigned int inRate, unsigned int outRate, ResampleQuality quality);
+
+/**
+ * @brief Free the filter bank.
+ */
+void resampler_free(Resampler *resampler);
+
+/**
+ * @brief Number of output frames for an input of the given length.
+ */
+uint64_t resampler_output_frames(const Resampler *resampler, uint64_t inFrames);
+
+/**
+ * @brief First input frame that output frame `output` reads. May be negative.
+ */
+int64_t resampler_first_input(const Resampler *resampler, uint64_t output);
+
+/**
+ * @brief Convert a run of one channel. Vectorised over the taps.
+ *
+ * @param resampler The resampler.
+ * @param in Planar input; in[0] is input frame inStart, and every frame
+ * from resampler_first_input(firstOutput) up to that of the last output
+ * plus taps must be present.
+ * @param inStart Input frame held by in[0].
+ * @param firstOutput Output frame to start at.
+ * @param out Receives outFrames samples.
+ * @param outFrames Number of output frames.
+ */
+void resampler_process(const Resampler *resampler, const float *in, int64_t inStart,
+                       uint64_t firstOutput, float *out, size_t outFrames);
+
+/**
+ * @brief Convert a whole interleaved signal, RESAMPLE_BLOCK output frames
+ * at a time. Frames before the start and past the end read as silence.
+ *
+ * @param resampler The resampler.
+ * @param channels Channels per frame, on both sides.
+ * @param inFrames Length of the input.
+ * @param read Supplies input frames.
+ * @param write Receives output frames, in order.
+ * @param context Passed to read and write.
+ * @return False if the block buffers could not be allocated.
+ */
+bool resampler_convert(const Resampler *resampler, unsigned int channels, uint64_t inFrames,
+                       ResampleRead read, ResampleWrite write, void *context);
+
+#endif // RESAMPLE_H
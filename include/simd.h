@@ -0,0 +1,170 @@
+// simd.h
+
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+ * Minimal 4-lane float vector layer shared by the DSP stages.
+ *
+ * Maps onto SSE2 on x86, NEON on ARM (Apple Silicon) and a plain struct
+ * everywhere else, so kernels are written once against vf4_* / vu4_* and
+ * stay portable. Only the handful of operations the DSP code needs are
+ * provided. Define SIMD_SCALAR to force the portable path.
+ */
+
+#include <stdint.h>
+
+#if !defined(SIMD_SCALAR) && (defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64))
+#include <emmintrin.h>
+#define SIMD_SSE 1
+typedef __m128 vf4;
+typedef __m128i vu4;
+
+static inline vf4 vf4_zero(void) { return _mm_setzero_ps(); }
+static inline vf4 vf4_set1(float x) { return _mm_set1_ps(x); }
+static inline vf4 vf4_setr(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline vf4 vf4_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void vf4_store(float *p, vf4 v) { _mm_storeu_ps(p, v); }
+static inline vf4 vf4_add(vf4 a, vf4 b) { return _mm_add_ps(a, b); }
+static inline vf4 vf4_sub(vf4 a, vf4 b) { return _mm_sub_ps(a, b); }
+static inline vf4 vf4_mul(vf4 a, vf4 b) { return _mm_mul_ps(a, b); }
+static inline vf4 vf4_madd(vf4 acc, vf4 a, vf4 b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+static inline vf4 vf4_max(vf4 a, vf4 b) { return _mm_max_ps(a, b); }
+static inline vf4 vf4_min(vf4 a, vf4 b) { return _mm_min_ps(a, b); }
+static inline vf4 vf4_abs(vf4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+static inline float vf4_hsum(vf4 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+static inline float vf4_hmax(vf4 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 maxs = _mm_max_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, maxs);
+    return _mm_cvtss_f32(_mm_max_ss(maxs, shuf));
+}
+
+static inline vu4 vu4_load(const uint32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void vu4_store(uint32_t *p, vu4 v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline vu4 vu4_set1(uint32_t x) { return _mm_set1_epi32((int)x); }
+static inline vu4 vu4_add(vu4 a, vu4 b) { return _mm_add_epi32(a, b); }
+static inline vu4 vu4_xor(vu4 a, vu4 b) { return _mm_xor_si128(a, b); }
+static inline vu4 vu4_or(vu4 a, vu4 b) { return _mm_or_si128(a, b); }
+#define vu4_shl(a, n) _mm_slli_epi32((a), (n))
+#define vu4_shr(a, n) _mm_srli_epi32((a), (n))
+static inline vf4 vu4_as_vf4(vu4 a) { return _mm_castsi128_ps(a); }
+
+#elif !defined(SIMD_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define SIMD_NEON 1
+typedef float32x4_t vf4;
+typedef uint32x4_t vu4;
+
+static inline vf4 vf4_zero(void) { return vdupq_n_f32(0.0f); }
+static inline vf4 vf4_set1(float x) { return vdupq_n_f32(x); }
+static inline vf4 vf4_setr(float a, float b, float c, float d) {
+    float tmp[4] = {a, b, c, d};
+    return vld1q_f32(tmp);
+}
+static inline vf4 vf4_load(const float *p) { return vld1q_f32(p); }
+static inline void vf4_store(float *p, vf4 v) { vst1q_f32(p, v); }
+static inline vf4 vf4_add(vf4 a, vf4 b) { return vaddq_f32(a, b); }
+static inline vf4 vf4_sub(vf4 a, vf4 b) { return vsubq_f32(a, b); }
+static inline vf4 vf4_mul(vf4 a, vf4 b) { return vmulq_f32(a, b); }
+static inline vf4 vf4_madd(vf4 acc, vf4 a, vf4 b) { return vmlaq_f32(acc, a, b); }
+static inline vf4 vf4_max(vf4 a, vf4 b) { return vmaxq_f32(a, b); }
+static inline vf4 vf4_min(vf4 a, vf4 b) { return vminq_f32(a, b); }
+static inline vf4 vf4_abs(vf4 a) { return vabsq_f32(a); }
+
+static inline float vf4_hsum(vf4 v) {
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+static inline float vf4_hmax(vf4 v) {
+    float32x2_t m = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(m, m), 0);
+}
+
+static inline vu4 vu4_load(const uint32_t *p) { return vld1q_u32(p); }
+static inline void vu4_store(uint32_t *p, vu4 v) { vst1q_u32(p, v); }
+static inline vu4 vu4_set1(uint32_t x) { return vdupq_n_u32(x); }
+static inline vu4 vu4_add(vu4 a, vu4 b) { return vaddq_u32(a, b); }
+static inline vu4 vu4_xor(vu4 a, vu4 b) { return veorq_u32(a, b); }
+static inline vu4 vu4_or(vu4 a, vu4 b) { return vorrq_u32(a, b); }
+#define vu4_shl(a, n) vshlq_n_u32((a), (n))
+#define vu4_shr(a, n) vshrq_n_u32((a), (n))
+static inline vf4 vu4_as_vf4(vu4 a) { return vreinterpretq_f32_u32(a); }
+
+#else
+#include <math.h>
+#include <string.h>
+typedef struct { float v[4]; } vf4;
+typedef struct { uint32_t v[4]; } vu4;
+
+static inline vf4 vf4_zero(void) { vf4 r = {{0.0f, 0.0f, 0.0f, 0.0f}}; return r; }
+static inline vf4 vf4_set1(float x) { vf4 r = {{x, x, x, x}}; return r; }
+static inline vf4 vf4_setr(float a, float b, float c, float d) { vf4 r = {{a, b, c, d}}; return r; }
+static inline vf4 vf4_load(const float *p) { vf4 r = {{p[0], p[1], p[2], p[3]}}; return r; }
+static inline void vf4_store(float *p, vf4 v) { p[0] = v.v[0]; p[1] = v.v[1]; p[2] = v.v[2]; p[3] = v.v[3]; }
+
+#define VF4_MAP2(name, expr) \
+    static inline vf4 name(vf4 a, vf4 b) { \
+        vf4 r; \
+        for (int i = 0; i < 4; ++i) r.v[i] = (expr); \
+        return r; \
+    }
+VF4_MAP2(vf4_add, a.v[i] + b.v[i])
+VF4_MAP2(vf4_sub, a.v[i] - b.v[i])
+VF4_MAP2(vf4_mul, a.v[i] * b.v[i])
+VF4_MAP2(vf4_max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+VF4_MAP2(vf4_min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+#undef VF4_MAP2
+
+static inline vf4 vf4_madd(vf4 acc, vf4 a, vf4 b) { return vf4_add(acc, vf4_mul(a, b)); }
+static inline vf4 vf4_abs(vf4 a) {
+    vf4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = fabsf(a.v[i]);
+    return r;
+}
+static inline float vf4_hsum(vf4 v) { return (v.v[0] + v.v[1]) + (v.v[2] + v.v[3]); }
+static inline float vf4_hmax(vf4 v) {
+    float a = v.v[0] > v.v[1] ? v.v[0] : v.v[1];
+    float b = v.v[2] > v.v[3] ? v.v[2] : v.v[3];
+    return a > b ? a : b;
+}
+
+static inline vu4 vu4_load(const uint32_t *p) { vu4 r = {{p[0], p[1], p[2], p[3]}}; return r; }
+static inline void vu4_store(uint32_t *p, vu4 v) { p[0] = v.v[0]; p[1] = v.v[1]; p[2] = v.v[2]; p[3] = v.v[3]; }
+static inline vu4 vu4_set1(uint32_t x) { vu4 r = {{x, x, x, x}}; return r; }
+
+#define VU4_MAP2(name, expr) \
+    static inline vu4 name(vu4 a, vu4 b) { \
+        vu4 r; \
+        for (int i = 0; i < 4; ++i) r.v[i] = (expr); \
+        return r; \
+    }
+VU4_MAP2(vu4_add, a.v[i] + b.v[i])
+VU4_MAP2(vu4_xor, a.v[i] ^ b.v[i])
+VU4_MAP2(vu4_or, a.v[i] | b.v[i])
+#undef VU4_MAP2
+
+static inline vu4 vu4_shl(vu4 a, int n) {
+    for (int i = 0; i < 4; ++i) a.v[i] <<= n;
+    return a;
+}
+static inline vu4 vu4_shr(vu4 a, int n) {
+    for (int i = 0; i < 4; ++i) a.v[i] >>= n;
+    return a;
+}
+static inline vf4 vu4_as_vf4(vu4 a) {
+    vf4 r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+#endif
+
+#endif // SIMD_H
@@ -0,0 +1,42 @@
+// string_arena.h
+
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STRING_ARENA_NONE SIZE_MAX // Returned when the arena cannot grow
+
+/**
+ * @brief Append-only store for NUL-terminated strings, addressed by offset
+ * so that growing it never invalidates a reference.
+ */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} StringArena;
+
+/**
+ * @brief Copy a string into the arena.
+ *
+ * @param arena The arena.
+ * @param text String to store.
+ * @return Offset of the copy, or STRING_ARENA_NONE if out of memory.
+ */
+size_t string_arena_add(StringArena *arena, const char *text);
+
+/**
+ * @brief String stored at an offset returned by string_arena_add.
+ */
+static inline const char* string_arena_get(const StringArena *arena, size_t offset) {
+    return arena->data + offset;
+}
+
+/**
+ * @brief Free the arena's storage.
+ */
+void string_arena_free(StringArena *arena);
+
+#endif // STRING_ARENA_H
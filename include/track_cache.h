@@ -0,0 +1,58 @@
+// track_cache.h
+
+#ifndef TRACK_CACHE_H
+#define TRACK_CACHE_H
+
+#include <stddef.h>
+#include "player.h"
+
+#define TRACK_CACHE_ENTRIES 16 // Tracks kept at most, mapped ones included
+
+// Tracks kept for replays and back-skips: make CACHE_MB=<megabytes>
+#ifndef TRACK_CACHE_MB
+#define TRACK_CACHE_MB 256
+#endif
+
+/**
+ * @brief Set the memory ceiling, evicting least recently used tracks to
+ * meet it.
+ *
+ * @param bytes Heap the cache may hold, as player_track_bytes counts it;
+ * 0 disables caching.
+ *
+ * Mapped and streamed tracks cost little heap and count mostly towards
+ * TRACK_CACHE_ENTRIES.
+ */
+void track_cache_set_limit(size_t bytes);
+
+/**
+ * @brief Hand a track nobody plays any more to the cache instead of freeing
+ * it. Thread-safe.
+ *
+ * @param track Track no longer reachable by the player; NULL is ignored.
+ *
+ * The track becomes the most recently used entry. It is freed right away if
+ * it does not fit under the ceiling on its own.
+ */
+void track_cache_put(PlayerTrack *track);
+
+/**
+ * @brief Take a cached track back out. Thread-safe.
+ *
+ * @param path File the track was loaded from.
+ * @return The track, now owned by the caller, or NULL if it is not cached
+ * or the file changed since it was loaded.
+ */
+PlayerTrack* track_cache_take(const char *path);
+
+/**
+ * @brief Free every cached track.
+ */
+void track_cache_clear(void);
+
+/**
+ * @brief Decoded PCM currently held (bytes).
+ */
+size_t track_cache_bytes(void);
+
+#endif // TRACK_CACHE_H
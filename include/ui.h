@@ -26,6 +26,7 @@ typedef struct {
 // Function declarations
 void InitUI(void);
 void HandleInput(void);
+void HandleAnalysisInput(void);
 void UpdatePlaybackState(void);
 void RenderUI(size_t numberOfFftBins, AudioData *audioData);
 void CleanupUI(void);
@@ -37,9 +38,14 @@ void DrawUI(Layout layout, size_t numberOfFftBins, AudioData *audioData);
 void DrawTitleBar(Rectangle titleBar);
 void DrawSongQueue(Rectangle queueBounds);
 void DrawPlaybackControls(Rectangle playbackControlPanel);
-void DrawProgressBar(Music music,Rectangle progressBarBounds);
-void DrawTotalTime(Music music, Rectangle progressBarBounds);
+void DrawProgressBar(Rectangle progressBarBounds);
+void DrawTotalTime(Rectangle progressBarBounds);
 void DrawSampleInfo(Layout layout);
+void DrawLoudnessMeter(Rectangle visualizerSpace);
+void DrawLatencyPanel(Rectangle visualizerSpace);
+#ifdef ENABLE_PROFILER
+void DrawProfilerOverlay(Rectangle visualizerSpace);
+#endif
 void DrawVisualizerSelection(bool* showList, Rectangle buttonBounds);
 void RenderVisualizer(float out_smooth[], size_t numBins, Rectangle visualizerSpace);
 void DrawStatusMessage(const char* text, Rectangle titleBar);
@@ -0,0 +1,81 @@
+// wav_map.h
+
+#ifndef WAV_MAP_H
+#define WAV_MAP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WAV_MAP_READAHEAD_FRAMES 88200 // Frames paged in ahead of a sequential reader (~2 s)
+
+typedef enum {
+    WAV_SAMPLE_U8,
+    WAV_SAMPLE_S16,
+    WAV_SAMPLE_S24,
+    WAV_SAMPLE_S32,
+    WAV_SAMPLE_F32
+} WavSampleFormat;
+
+/**
+ * @brief A PCM or IEEE float WAV file mapped into memory. Frames are served
+ * straight from the mapping; nothing is copied until they are converted.
+ */
+typedef struct {
+    void *mapping;            /**< Whole file, read-only */
+    size_t mappingSize;
+    const unsigned char *data; /**< First byte of the first frame */
+    uint64_t frameCount;
+    unsigned int sampleRate;  /**< Hz */
+    unsigned int channels;
+    unsigned int bitsPerSample;
+    unsigned int bytesPerFrame;
+    WavSampleFormat format;
+} WavMap;
+
+/**
+ * @brief Map a WAV file and locate its sample data.
+ *
+ * @param wav Receives the mapping.
+ * @param path File to open.
+ * @return False, without printing, if the file is not a WAV in a supported
+ * sample format; callers fall back to a decoder.
+ */
+bool wav_map_open(WavMap *wav, const char *path);
+
+/**
+ * @brief Unmap a file opened with wav_map_open. Safe on a zeroed WavMap.
+ */
+void wav_map_close(WavMap *wav);
+
+/**
+ * @brief Address of a frame in the mapping.
+ */
+static inline const unsigned char* wav_map_frame(const WavMap *wav, uint64_t frame) {
+    return wav->data + frame * wav->bytesPerFrame;
+}
+
+/**
+ * @brief Convert frames from the mapping to interleaved float.
+ *
+ * @param wav The mapped file.
+ * @param frame First frame to read.
+ * @param out Receives frames * outChannels samples in [-1, 1).
+ * @param frames Number of frames to read; clipped to the end of the file.
+ * @param outChannels Output channel count. Mono input is duplicated; with a
+ * single output channel only the first input channel is read.
+ * @return Frames converted.
+ */
+size_t wav_map_read_float(const WavMap *wav, uint64_t frame, float *out, size_t frames, unsigned int outChannels);
+
+/**
+ * @brief Ask the kernel to page in a range of frames ahead of a sequential
+ * reader.
+ *
+ * @param wav The mapped file.
+ * @param frame First frame of the range.
+ * @param frames Length of the range.
+ */
+void wav_map_advise(const WavMap *wav, uint64_t frame, uint64_t frames);
+
+#endif // WAV_MAP_H
@@ -0,0 +1,56 @@
+// window.h
+
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stddef.h>
+
+/**
+ * @brief Enumeration of the analysis window functions in the registry.
+ */
+typedef enum {
+    WINDOW_HANN,             /**< Hann (raised cosine) */
+    WINDOW_BLACKMAN_HARRIS,  /**< 4-term Blackman-Harris, -92 dB sidelobes */
+    WINDOW_KAISER,           /**< Kaiser, beta = 9 */
+    WINDOW_FLAT_TOP,         /**< 5-term flat-top for amplitude accuracy */
+    WINDOW_GAUSSIAN,         /**< Gaussian, sigma = 0.4 */
+    WINDOW_TYPE_COUNT
+} WindowType;
+
+/**
+ * @brief Get the cached coefficient table for a window type and size.
+ *
+ * Tables are built on first request and kept for the lifetime of the
+ * process, so repeated lookups and runtime switching cost no recomputation.
+ * Independent analysers may hold tables of different types and sizes at once.
+ *
+ * @param type The window function.
+ * @param size The number of coefficients (the analysis frame length).
+ * @return Pointer to the coefficients, or NULL on allocation failure.
+ */
+const float* get_window_table(WindowType type, size_t size);
+
+/**
+ * @brief Multiply a signal by an explicit window table.
+ *
+ * @param input The input signal array.
+ * @param output The output array to store the windowed signal.
+ * @param window The window coefficients from get_window_table.
+ * @param n The number of samples to process.
+ */
+void apply_window(const float input[], float output[], const float window[], size_t n);
+
+/**
+ * @brief Get a human-readable name for a window type.
+ *
+ * @param type The window function.
+ * @return A static string naming the window.
+ */
+const char* window_name(WindowType type);
+
+/**
+ * @brief Release every cached window table.
+ */
+void free_window_tables(void);
+
+#endif // WINDOW_H
@@ -0,0 +1,210 @@
+// alloc_tracker.c
+//
+// Opt-in heap allocation tracker (make TRACK_ALLOC=1). Counts every
+// malloc/free in the process, including those made inside raylib and
+// miniaudio, per thread, and reports frames of the main loop in which any
+// thread touched the heap.
+//
+// glibc: malloc and friends are interposed here and forward to the
+// __libc_* entry points. macOS: the system allocator's malloc_logger hook is
+// used. Elsewhere the tracker reports that it is unavailable.
+
+#include "../../include/alloc_tracker.h"
+
+#ifdef ENABLE_ALLOC_TRACKER
+
+#include <stdio.h>
+
+/**
+ * @brief Heap activity of one thread. Written only by its thread; read by
+ * the render loop with relaxed atomics.
+ */
+typedef struct {
+    const char *name;
+    bool worker;              /**< Background thread, never reported per frame */
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes;
+    // Render loop side: values at the end of the previous frame
+    uint64_t lastAllocs;
+    uint64_t lastFrees;
+    uint64_t lastBytes;
+    uint64_t violations;      /**< Frames in which this thread used the heap */
+} ThreadAllocStats;
+
+static ThreadAllocStats thread_stats[ALLOC_TRACKER_MAX_THREADS + 1]; // Last slot: overflow
+static unsigned int thread_count = 0;
+static __thread ThreadAllocStats *current_thread = NULL;
+
+static uint64_t frame_number = 0;
+static bool frame_allowed = false;
+static uint64_t violating_frames = 0;
+
+static ThreadAllocStats* thread_slot(void) {
+    if (current_thread == NULL) {
+        unsigned int index = __atomic_fetch_add(&thread_count, 1, __ATOMIC_RELAXED);
+        if (index > ALLOC_TRACKER_MAX_THREADS) index = ALLOC_TRACKER_MAX_THREADS;
+        current_thread = &thread_stats[index];
+    }
+    return current_thread;
+}
+
+static inline void count_event(uint64_t *counter, uint64_t amount) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+static inline void note_alloc(size_t size) {
+    ThreadAllocStats *stats = thread_slot();
+    count_event(&stats->allocs, 1);
+    count_event(&stats->bytes, size);
+}
+
+static inline void note_free(void) {
+    count_event(&thread_slot()->frees, 1);
+}
+
+#if defined(__GLIBC__)
+
+// Aligned allocations are not interposed; only their free is counted
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    note_alloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    note_alloc(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (ptr != NULL) note_free();
+    note_alloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    if (ptr != NULL) note_free();
+    __libc_free(ptr);
+}
+
+static bool install_hooks(void) {
+    return true;
+}
+
+#elif defined(__APPLE__)
+
+// Private but stable libmalloc hook, also used by MallocStackLogging
+#define MALLOC_LOG_TYPE_ALLOCATE 2
+#define MALLOC_LOG_TYPE_DEALLOCATE 4
+#define MALLOC_LOG_TYPE_HAS_ZONE 8
+
+typedef void (malloc_logger_t)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3,
+                               uintptr_t result, uint32_t numHotFramesToSkip);
+extern malloc_logger_t *malloc_logger;
+
+static void logger_hook(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3,
+                        uintptr_t result, uint32_t numHotFramesToSkip) {
+    (void)arg1;
+    (void)result;
+    (void)numHotFramesToSkip;
+
+    bool allocate = (type & MALLOC_LOG_TYPE_ALLOCATE) != 0;
+    bool deallocate = (type & MALLOC_LOG_TYPE_DEALLOCATE) != 0;
+
+    if (deallocate) note_free();
+    if (allocate) {
+        // realloc logs (zone, old pointer, new size); malloc logs (zone, size)
+        note_alloc(deallocate ? (size_t)arg3 : (size_t)arg2);
+    }
+}
+
+static bool install_hooks(void) {
+    malloc_logger = logger_hook;
+    return true;
+}
+
+#else
+
+static bool install_hooks(void) {
+    return false;
+}
+
+#endif
+
+void alloc_tracker_name_thread(const char *name, bool worker) {
+    static bool hooked = false;
+    if (!hooked) {
+        hooked = true;
+        if (!install_hooks()) {
+            fprintf(stderr, "Allocation tracking is not supported on this platform\n");
+        }
+    }
+
+    ThreadAllocStats *stats = thread_slot();
+    if (stats->name == NULL) {
+        stats->name = name;
+        stats->worker = worker;
+    }
+}
+
+void alloc_tracker_allow_frame(void) {
+    frame_allowed = true;
+}
+
+void alloc_tracker_end_frame(void) {
+    unsigned int count = __atomic_load_n(&thread_count, __ATOMIC_RELAXED);
+    if (count > ALLOC_TRACKER_MAX_THREADS + 1) count = ALLOC_TRACKER_MAX_THREADS + 1;
+
+    bool report = frame_number >= ALLOC_TRACKER_WARMUP_FRAMES && !frame_allowed;
+    bool violated = false;
+
+    for (unsigned int t = 0; t < count; ++t) {
+        ThreadAllocStats *stats = &thread_stats[t];
+        uint64_t allocs = __atomic_load_n(&stats->allocs, __ATOMIC_RELAXED) - stats->lastAllocs;
+        uint64_t frees = __atomic_load_n(&stats->frees, __ATOMIC_RELAXED) - stats->lastFrees;
+        uint64_t bytes = __atomic_load_n(&stats->bytes, __ATOMIC_RELAXED) - stats->lastBytes;
+
+        if (report && !stats->worker && (allocs != 0 || frees != 0)) {
+            fprintf(stderr, "alloc: frame %llu thread %u (%s): %llu allocs, %llu frees, %llu bytes\n",
+                    (unsigned long long)frame_number, t, stats->name ? stats->name : "unnamed",
+                    (unsigned long long)allocs, (unsigned long long)frees, (unsigned long long)bytes);
+            stats->violations++;
+            violated = true;
+        }
+    }
+
+    // Snapshot after reporting so the report's own allocations are not
+    // charged to the next frame
+    for (unsigned int t = 0; t < count; ++t) {
+        ThreadAllocStats *stats = &thread_stats[t];
+        stats->lastAllocs = __atomic_load_n(&stats->allocs, __ATOMIC_RELAXED);
+        stats->lastFrees = __atomic_load_n(&stats->frees, __ATOMIC_RELAXED);
+        stats->lastBytes = __atomic_load_n(&stats->bytes, __ATOMIC_RELAXED);
+    }
+
+    if (violated) violating_frames++;
+    frame_allowed = false;
+    frame_number++;
+}
+
+void alloc_tracker_print_summary(void) {
+    unsigned int count = __atomic_load_n(&thread_count, __ATOMIC_RELAXED);
+    if (count > ALLOC_TRACKER_MAX_THREADS + 1) count = ALLOC_TRACKER_MAX_THREADS + 1;
+
+    fprintf(stderr, "alloc: %llu of %llu frames allocated in steady state\n",
+            (unsigned long long)violating_frames, (unsigned long long)frame_number);
+    for (unsigned int t = 0; t < count; ++t) {
+        const ThreadAllocStats *stats = &thread_stats[t];
+        fprintf(stderr, "alloc: thread %u (%s): %llu allocs, %llu frees, %llu bytes, %llu violating frames\n",
+                t, stats->name ? stats->name : "unnamed",
+                (unsigned long long)stats->allocs, (unsigned long long)stats->frees,
+                (unsigned long long)stats->bytes, (unsigned long long)stats->violations);
+    }
+}
+
+#endif // ENABLE_ALLOC_TRACKER
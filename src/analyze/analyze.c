@@ -0,0 +1,338 @@
+// analyze.c
+//
+// bragibeats-analyze: headless spectrum analysis. Decodes a WAV/MP3 file
+// (PCM WAVs at the analysis rate are read straight from a file mapping,
+// files at other rates go through the player's resampler), feeds it through
+// the same input ring, window, FFT and band pipeline the visualizer uses,
+// one analysis frame per hop, and writes the band spectra to a file. No
+// window or audio device is opened.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../include/fft.h"
+#include "../../include/window.h"
+#include "../../include/wav_map.h"
+#include "../../include/resample.h"
+
+#define DEFAULT_HOP_SIZE 1024
+
+static float hopSamples[FFT_SIZE]; // One hop converted from a mapped WAV
+
+typedef struct {
+    const char *inputPath;
+    const char *outputPath;
+    size_t hopSize;
+    bool binary;             /**< Write raw float32 frames instead of CSV */
+    bool raw;                /**< Write unsmoothed out_log instead of out_smooth */
+    AnalysisMode mode;
+    WindowType window;
+    ResampleQuality quality; /**< Filter for files not at SAMPLE_RATE */
+} AnalyzeOptions;
+
+/**
+ * @brief First channel of a file at another rate, on its way to SAMPLE_RATE.
+ */
+typedef struct {
+    const WavMap *map;       /**< Mapped PCM to read, or NULL */
+    const float *samples;    /**< Otherwise, decoded interleaved samples */
+    size_t channels;
+    float *out;              /**< Mono at SAMPLE_RATE */
+} ResampleSource;
+
+// Large enough that it should not live on the stack
+static AudioData audioData;
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <input.wav|input.mp3>\n"
+            "  -o <file>    Output file (default: stdout)\n"
+            "  -h <frames>  Hop size in frames (default: %d)\n"
+            "  -w <window>  Window function name or index (default: Blackman-Harris)\n"
+            "  -q <quality> Resampler for files not at %d Hz: fast, medium, best (default: medium)\n"
+            "  -m           Multi-resolution analysis\n"
+            "  -r           Write unsmoothed spectra\n"
+            "  -b           Write float32 binary frames instead of CSV\n",
+            program, DEFAULT_HOP_SIZE, (int)SAMPLE_RATE);
+}
+
+static bool parse_window(const char *arg, WindowType *window) {
+    char *end;
+    long index = strtol(arg, &end, 10);
+    if (*end == '\0' && index >= 0 && index < WINDOW_TYPE_COUNT) {
+        *window = (WindowType)index;
+        return true;
+    }
+
+    for (int i = 0; i < WINDOW_TYPE_COUNT; ++i) {
+        if (strcmp(arg, window_name((WindowType)i)) == 0) {
+            *window = (WindowType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_quality(const char *arg, ResampleQuality *quality) {
+    for (int i = 0; i < RESAMPLE_QUALITY_COUNT; ++i) {
+        if (strcmp(arg, resample_quality_name((ResampleQuality)i)) == 0) {
+            *quality = (ResampleQuality)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void read_first_channel(void *context, uint64_t frame, float *out, size_t frames) {
+    const ResampleSource *source = (const ResampleSource *)context;
+    if (source->map != NULL) {
+        wav_map_read_float(source->map, frame, out, frames, 1);
+        return;
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        out[i] = source->samples[(frame + i) * source->channels];
+    }
+}
+
+static void write_mono(void *context, uint64_t frame, const float *in, size_t frames) {
+    memcpy(((ResampleSource *)context)->out + frame, in, frames * sizeof(float));
+}
+
+// Converts the first channel of a source at `rate` to SAMPLE_RATE; NULL if
+// the resampler refuses the rate pair or memory runs out
+static float* resample_first_channel(ResampleSource *source, unsigned int rate, size_t frames,
+                                     ResampleQuality quality, size_t *outFrames) {
+    Resampler resampler;
+    if (!resampler_init(&resampler, rate, (unsigned int)SAMPLE_RATE, quality)) return NULL;
+
+    *outFrames = (size_t)resampler_output_frames(&resampler, frames);
+    source->out = (float *)malloc(*outFrames * sizeof(float));
+    if (source->out == NULL) {
+        fprintf(stderr, "Failed to allocate %zu resampled frames\n", *outFrames);
+    } else if (!resampler_convert(&resampler, 1, frames, read_first_channel, write_mono, source)) {
+        free(source->out);
+        source->out = NULL;
+    }
+
+    resampler_free(&resampler);
+    return source->out;
+}
+
+static bool parse_options(int argc, char **argv, AnalyzeOptions *options) {
+    options->inputPath = NULL;
+    options->outputPath = NULL;
+    options->hopSize = DEFAULT_HOP_SIZE;
+    options->binary = false;
+    options->raw = false;
+    options->mode = ANALYSIS_SINGLE_RESOLUTION;
+    options->window = WINDOW_BLACKMAN_HARRIS;
+    options->quality = RESAMPLE_MEDIUM;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(arg, "-o") == 0 && hasValue) {
+            options->outputPath = argv[++i];
+        } else if (strcmp(arg, "-h") == 0 && hasValue) {
+            long hop = strtol(argv[++i], NULL, 10);
+            if (hop <= 0 || hop > FFT_SIZE) {
+                fprintf(stderr, "Hop size must be between 1 and %d\n", FFT_SIZE);
+                return false;
+            }
+            options->hopSize = (size_t)hop;
+        } else if (strcmp(arg, "-w") == 0 && hasValue) {
+            if (!parse_window(argv[++i], &options->window)) {
+                fprintf(stderr, "Unknown window function: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(arg, "-q") == 0 && hasValue) {
+            if (!parse_quality(argv[++i], &options->quality)) {
+                fprintf(stderr, "Unknown resampler quality: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(arg, "-m") == 0) {
+            options->mode = ANALYSIS_MULTI_RESOLUTION;
+        } else if (strcmp(arg, "-r") == 0) {
+            options->raw = true;
+        } else if (strcmp(arg, "-b") == 0) {
+            options->binary = true;
+        } else if (arg[0] != '-' && options->inputPath == NULL) {
+            options->inputPath = arg;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+
+    return options->inputPath != NULL;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void write_frame(FILE *out, const AnalyzeOptions *options, double time,
+                        const float *spectrum, size_t numberOfBins) {
+    if (options->binary) {
+        float timestamp = (float)time;
+        fwrite(&timestamp, sizeof(float), 1, out);
+        fwrite(spectrum, sizeof(float), numberOfBins, out);
+        return;
+    }
+
+    fprintf(out, "%.6f", time);
+    for (size_t i = 0; i < numberOfBins; ++i) {
+        fprintf(out, ",%.6f", spectrum[i]);
+    }
+    fputc('\n', out);
+}
+
+int main(int argc, char **argv) {
+    AnalyzeOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    double decodeStart = now_seconds();
+
+    // A PCM WAV at the analysis rate needs no decode: hops are converted
+    // from the mapping as they are analysed. At another rate, its first
+    // channel is resampled from the mapping up front
+    WavMap map;
+    bool mapped = wav_map_open(&map, options.inputPath);
+
+    float *samples = NULL;
+    bool resampled = false;  /**< samples came from the resampler, not raylib */
+    size_t channels = 1;
+    size_t frameCount = 0;
+
+    if (mapped && map.sampleRate != SAMPLE_RATE) {
+        ResampleSource source = { .map = &map };
+        samples = resample_first_channel(&source, map.sampleRate, (size_t)map.frameCount,
+                                         options.quality, &frameCount);
+        resampled = samples != NULL;
+        wav_map_close(&map);
+        mapped = false;
+    }
+
+    if (mapped) {
+        frameCount = (size_t)map.frameCount;
+    } else if (!resampled) {
+        Wave wave = LoadWave(options.inputPath);
+        if (wave.frameCount == 0 || wave.data == NULL) {
+            fprintf(stderr, "Failed to decode %s\n", options.inputPath);
+            return 1;
+        }
+
+        // Same rate and sample format the stream processor sees during playback
+        WaveFormat(&wave, wave.sampleRate, 32, wave.channels);
+        samples = LoadWaveSamples(wave);
+        channels = wave.channels;
+        frameCount = wave.frameCount;
+
+        if (samples != NULL && wave.sampleRate != SAMPLE_RATE) {
+            ResampleSource source = { .samples = samples, .channels = channels };
+            float *converted = resample_first_channel(&source, wave.sampleRate, frameCount,
+                                                      options.quality, &frameCount);
+            UnloadWaveSamples(samples);
+            if (converted != NULL) {
+                samples = converted;
+                resampled = true;
+                channels = 1;
+            } else {
+                // Rate pair the resampler refuses: fall back to raylib's conversion
+                WaveFormat(&wave, (int)SAMPLE_RATE, 32, wave.channels);
+                samples = LoadWaveSamples(wave);
+                frameCount = wave.frameCount;
+            }
+        }
+        UnloadWave(wave);
+
+        if (samples == NULL) {
+            fprintf(stderr, "Failed to convert samples of %s\n", options.inputPath);
+            return 1;
+        }
+    }
+    double decodeSeconds = now_seconds() - decodeStart;
+
+    FILE *out = stdout;
+    if (options.outputPath != NULL) {
+        out = fopen(options.outputPath, options.binary ? "wb" : "w");
+        if (out == NULL) {
+            fprintf(stderr, "Failed to open output file %s\n", options.outputPath);
+            if (mapped) {
+                wav_map_close(&map);
+            } else if (resampled) {
+                free(samples);
+            } else {
+                UnloadWaveSamples(samples);
+            }
+            return 1;
+        }
+    }
+
+    init_audio_data(&audioData, SAMPLE_RATE);
+    set_window_function(options.window);
+    currentAnalysisMode = options.mode;
+
+    float hopSeconds = (float)options.hopSize / SAMPLE_RATE;
+    size_t frameIndex = 0;
+    size_t analysisFrames = 0;
+
+    double analysisStart = now_seconds();
+    while (frameIndex < frameCount) {
+        size_t count = options.hopSize;
+        if (count > frameCount - frameIndex) count = frameCount - frameIndex;
+
+        // Mono analysis of the first channel, as in the stream callback
+        if (mapped) {
+            wav_map_read_float(&map, frameIndex, hopSamples, count, 1);
+            write_audio_ring(&audioData, hopSamples, count, 1);
+        } else {
+            write_audio_ring(&audioData, samples + frameIndex * channels, count, channels);
+        }
+        frameIndex += count;
+
+        size_t numberOfBins = analyze_spectrum(&audioData, hopSeconds);
+        const float *spectrum = options.raw ? audioData.out_log : audioData.out_smooth;
+        write_frame(out, &options, (double)frameIndex / SAMPLE_RATE, spectrum, numberOfBins);
+        analysisFrames++;
+    }
+    double analysisSeconds = now_seconds() - analysisStart;
+
+    if (out != stdout) fclose(out);
+    if (mapped) {
+        wav_map_close(&map);
+    } else if (resampled) {
+        free(samples);
+    } else {
+        UnloadWaveSamples(samples);
+    }
+
+    double audioSeconds = (double)frameCount / SAMPLE_RATE;
+    double totalSeconds = decodeSeconds + analysisSeconds;
+    fprintf(stderr, "%s: %.2f s of audio, %zu frames (hop %zu, %s, %s, %s)\n",
+            options.inputPath, audioSeconds, analysisFrames, options.hopSize,
+            mapped ? "mapped" : (resampled ? "resampled" : "decoded"),
+            window_name(options.window),
+            options.mode == ANALYSIS_MULTI_RESOLUTION ? "multi-resolution" : "single-resolution");
+    fprintf(stderr, "decode   %8.3f s  %8.1fx realtime\n", decodeSeconds,
+            decodeSeconds > 0.0 ? audioSeconds / decodeSeconds : 0.0);
+    fprintf(stderr, "analysis %8.3f s  %8.1fx realtime\n", analysisSeconds,
+            analysisSeconds > 0.0 ? audioSeconds / analysisSeconds : 0.0);
+    fprintf(stderr, "total    %8.3f s  %8.1fx realtime\n", totalSeconds,
+            totalSeconds > 0.0 ? audioSeconds / totalSeconds : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+// string_arena.c
+
+#include "../../include/string_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRING_ARENA_INITIAL_CAPACITY 16384
+
+size_t string_arena_add(StringArena *arena, const char *text) {
+    size_t size = strlen(text) + 1;
+
+    if (arena->length + size > arena->capacity) {
+        size_t capacity = arena->capacity > 0 ? arena->capacity : STRING_ARENA_INITIAL_CAPACITY;
+        while (arena->length + size > capacity) capacity *= 2;
+
+        char *data = (char *)realloc(arena->data, capacity);
+        if (data == NULL) {
+            fprintf(stderr, "Failed to grow the string arena to %zu bytes\n", capacity);
+            return STRING_ARENA_NONE;
+        }
+        arena->data = data;
+        arena->capacity = capacity;
+    }
+
+    size_t offset = arena->length;
+    memcpy(arena->data + offset, text, size);
+    arena->length += size;
+    return offset;
+}
+
+void string_arena_free(StringArena *arena) {
+    free(arena->data);
+    arena->data = NULL;
+    arena->length = 0;
+    arena->capacity = 0;
+}
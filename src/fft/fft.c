@@ -1,56 +1,79 @@
 // audio_processing.c
 
 #include "../../include/fft.h"
-#include "../../include/playback.h"
+#include "../../include/window.h"
+#include "../../include/profiler.h"
 #include <complex.h>
 #include <math.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <raylib.h>
 
 #define NUM_BINS 64
-#define SAMPLE_RATE 44100.0f
 #define EPSILON 1e-6f
+#define MULTIRES_TIERS 3
 
-// Precomputed window coefficients
-static float window_coefficients[FFT_SIZE];
+// Active window table, owned by the window registry
+static const float *window_coefficients = NULL;
+static WindowType currentWindow = WINDOW_BLACKMAN_HARRIS;
 // Precomputed bit-reversal indices
 static size_t bit_reversal_indices[FFT_SIZE];
 // Precomputed twiddle factors
 static float complex twiddle_factors[FFT_SIZE / 2];
+// Sizes the tables above were computed for
+static size_t bit_reversal_bits = 0;
+static size_t twiddle_table_size = 0;
 
 TestSignalType currentTestSignal;
+static TestSignalGenerator testSignalGenerator;
+static bool testSignalGeneratorReady = false;
+AnalysisMode currentAnalysisMode = ANALYSIS_SINGLE_RESOLUTION;
 bool testMode = false;
 
 /**
- * @brief Compute the window coefficients using a Hanning window function.
+ * @brief Select the window function used by apply_window_function.
  *
- * This function precomputes the coefficients for a Hanning window,
- * which are used to reduce spectral leakage in the FFT.
+ * @param type The window function to switch to.
+ *
+ * The table comes from the window registry, so after the first use of a
+ * window this is only a pointer swap and can be done every frame. The
+ * previous window stays active if the table cannot be built.
+ */
+void set_window_function(WindowType type) {
+    const float *table = get_window_table(type, FFT_SIZE);
+    if (table == NULL) return;
+
+    window_coefficients = table;
+    currentWindow = type;
+}
+
+/**
+ * @brief Get the window function currently used by apply_window_function.
+ *
+ * @return The active window type.
+ */
+WindowType get_window_function(void) {
+    return currentWindow;
+}
+
+/**
+ * @brief Select the Hanning window for the FFT.
+ *
+ * Kept for existing callers; equivalent to set_window_function(WINDOW_HANN).
 */
 void compute_hann_window_coefficients(void) {
-    for (size_t i = 0; i < FFT_SIZE; ++i) {
-        float t = (float)i / (FFT_SIZE - 1);
-        window_coefficients[i] = 0.5f - 0.5f * cosf(2.0f * M_PI * t);
-    }
+    set_window_function(WINDOW_HANN);
 }
 
 /**
- * @brief Compute the window coefficients using the Blackman-Harris window
- * function.
+ * @brief Select the Blackman-Harris window for the FFT.
  *
- * This function precomputes the coefficients for a Blackman-Harris window,
- * which are used to reduce spectral leakage in the FFT.
+ * Kept for existing callers; equivalent to
+ * set_window_function(WINDOW_BLACKMAN_HARRIS).
  */
 void compute_bh_window_coefficients(void) {
-    for (size_t i = 0; i < FFT_SIZE; ++i) {
-        float t = (float)i / (FFT_SIZE - 1);
-        window_coefficients[i] = 0.35875f - 0.48829f * cosf(2.0f * M_PI * t) 
-                                + 0.14128f * cosf(4.0f * M_PI * t) 
-                                - 0.01168f * cosf(6.0f * M_PI * t);
-    }
+    set_window_function(WINDOW_BLACKMAN_HARRIS);
 }
 
 /**
@@ -72,6 +95,7 @@ void compute_bit_reversal_indices(size_t n) {
         }
         bit_reversal_indices[i] = reversed;
     }
+    bit_reversal_bits = log2n;
 }
 
 /**
@@ -86,6 +110,7 @@ void compute_twiddle_factors(size_t n) {
     for (size_t k = 0; k < n / 2; ++k) {
         twiddle_factors[k] = cexpf(-2.0f * I * M_PI * k / n);
     }
+    twiddle_table_size = n;
 }
 
 /**
@@ -93,13 +118,17 @@ void compute_twiddle_factors(size_t n) {
  * coefficients.
  *
  * @param audioData Pointer to the AudioData structure to initialize.
+ * @param sampleRate Rate the input ring will be filled at (Hz).
  *
  * This function initializes the audio data buffers and precomputes the window
  * coefficients, bit-reversal indices, and twiddle factors required for the
  * FFT.
  */
-void init_audio_data(AudioData *audioData) {
+void init_audio_data(AudioData *audioData, float sampleRate) {
+    audioData->sampleRate = sampleRate;
     audioData->bufferIndex = 0;
+    audioData->samplePosition = 0;
+    audioData->spectrumPosition = 0;
     compute_bh_window_coefficients();
     compute_bit_reversal_indices(FFT_SIZE);
     compute_twiddle_factors(FFT_SIZE);
@@ -114,85 +143,92 @@ void init_audio_data(AudioData *audioData) {
 }
 
 /**
- * @brief Perform an in-place iterative FFT using precomputed twiddle factors
- * and bit-reversal indices.
+ * @brief Perform an iterative radix-2 FFT of a real signal of any power-of-2
+ * length up to the size of the precomputed tables.
  *
- * @param audioData Pointer to the AudioData structure containing input and
- * output buffers.
+ * @param input The real input signal.
+ * @param output The complex frequency-domain output (n values).
  * @param n The size of the FFT (must be a power of 2).
  *
- * This function performs an in-place Fast Fourier Transform (FFT) on the input
- * data, storing the complex frequency-domain results in the output buffer.
+ * Shorter transforms reuse the tables computed for FFT_SIZE: the bit-reversal
+ * of i in log2(n) bits is the full-width reversal shifted right, and the
+ * twiddles for length m are every (table size / m)-th entry.
  */
-void fft(AudioData *audioData, size_t n) {
+void fft_transform(const float input[], float complex output[], size_t n) {
     if (n == 0 || (n & (n - 1)) != 0) {
         // n must be a power of 2 and greater than 0
         fprintf(stderr, "Error: FFT size must be a power of 2 and greater than 0.\n");
         return;
     }
+    if (n > twiddle_table_size || n > ((size_t)1 << bit_reversal_bits)) {
+        fprintf(stderr, "Error: FFT size %zu exceeds the precomputed tables.\n", n);
+        return;
+    }
+
+    size_t log2n = 0;
+    while (((size_t)1 << log2n) < n) ++log2n;
+    size_t shift = bit_reversal_bits - log2n;
 
     // Copy input to output and apply bit-reversal permutation
     for (size_t i = 0; i < n; ++i) {
-        audioData->out_raw[bit_reversal_indices[i]] = audioData->in_win[i];
+        output[bit_reversal_indices[i] >> shift] = input[i];
     }
 
     // Iterative FFT computation
-    size_t log2n = (size_t)log2(n);
     for (size_t s = 1; s <= log2n; ++s) {
-        size_t m = 1 << s;
+        size_t m = (size_t)1 << s;
         size_t half_m = m / 2;
-        size_t twiddle_step = n / m;
+        size_t twiddle_step = twiddle_table_size / m;
         for (size_t k = 0; k < n; k += m) {
             for (size_t j = 0; j < half_m; ++j) {
-                float complex t = twiddle_factors[j * twiddle_step] * audioData->out_raw[k + j + half_m];
-                float complex u = audioData->out_raw[k + j];
-                audioData->out_raw[k + j] = u + t;
-                audioData->out_raw[k + j + half_m] = u - t;
+                float complex t = twiddle_factors[j * twiddle_step] * output[k + j + half_m];
+                float complex u = output[k + j];
+                output[k + j] = u + t;
+                output[k + j + half_m] = u - t;
             }
         }
     }
 }
 
-static AudioData *audioDataPtr = NULL;
-
 /**
- * @brief Set the global pointer to teh AudioData structure for use in callbacks.
+ * @brief Perform an in-place iterative FFT using precomputed twiddle factors
+ * and bit-reversal indices.
  *
- * @param audioData Pointer to the AudioData structure to set.
+ * @param audioData Pointer to the AudioData structure containing input and
+ * output buffers.
+ * @param n The size of the FFT (must be a power of 2).
  *
- * This function sets the global `audioDataPtr` to the provided AudioData
- * pointer, allowing teh callback function to access and modify audio data.
+ * This function performs an in-place Fast Fourier Transform (FFT) on the input
+ * data, storing the complex frequency-domain results in the output buffer.
  */
-void set_audio_data(AudioData *audioData) {
-    audioDataPtr = audioData;
+void fft(AudioData *audioData, size_t n) {
+    fft_transform(audioData->in_win, audioData->out_raw, n);
 }
 
 /**
- * @brief Audio processing callback function for handling incoming audio data.
+ * @brief Append samples to the circular input buffer.
  *
- * @param bufferData Pointer to the buffer containing audio frames.
- * @praram frames The number of frames in the buffer.
+ * @param audioData Pointer to the AudioData structure owning the ring.
+ * @param samples Pointer to the first sample to copy.
+ * @param count The number of samples to append.
+ * @param stride Distance between consecutive samples (channel count for
+ * interleaved audio).
  *
- * This function is called whenever new audio data is available. It copies
- * the audio data into the `in_raw` buffer of the AudioData structure for
- * further processing
+ * This is the single ingestion path for both the audio callback and the
+ * streaming test signals. Only the newest FFT_SIZE samples can be kept, so
+ * older ones are skipped.
  */
-void callback(void *bufferData, unsigned int frames) {
-    if (audioDataPtr == NULL) return;
-
-    if (frames > FFT_SIZE) frames = FFT_SIZE;
-    //
-    // Check if audio is playing or in test mode
-    if (!isPlaying && !testMode) {
-        // Do not write to the buffer
-        return;
-    }
+void write_audio_ring(AudioData *audioData, const float *samples, size_t count, size_t stride) {
+    audioData->samplePosition += count;
 
-    float (*inputBuffer)[2] = bufferData;
+    if (count > FFT_SIZE) {
+        samples += (count - FFT_SIZE) * stride;
+        count = FFT_SIZE;
+    }
 
-    for (size_t i = 0; i < frames; ++i) {
-        audioDataPtr->in_raw[audioDataPtr->bufferIndex] = inputBuffer[i][0]; // Assuming mono input
-        audioDataPtr->bufferIndex = (audioDataPtr->bufferIndex + 1) % FFT_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        audioData->in_raw[audioData->bufferIndex] = samples[i * stride];
+        audioData->bufferIndex = (audioData->bufferIndex + 1) % FFT_SIZE;
     }
 }
 
@@ -204,70 +240,160 @@ void callback(void *bufferData, unsigned int frames) {
  * @param The number of samples to process
  *
  * This function multiplies each sample of the input signal by the corresponding
- * window coefficient reducing spectral leakage in the FFT.
+ * coefficient of the active window (see set_window_function), reducing
+ * spectral leakage in the FFT.
  */
 void apply_window_function(const float input[], float output[], size_t n) {
-    for (size_t i = 0; i < n; ++i) {
-        output[i] = input[i] * window_coefficients[i];
-    }
+    apply_window(input, output, window_coefficients, n);
 }
 
 /**
- * @brief Process the FFT and compute the amplitude specturm for visualization
- * @param audioData Pointer to the AudioData structure containing audio buffers
- * @return The number of frequency bins computed
- *
- * This function handles the processing of audio data for visualization,
- * including generating test signals, applying window functios, performing the
- * FFT, computing logarithmically spaced frequency bins, and applying perceptual
- * weighting and smoothing.
+ * @brief One FFT length of the multi-resolution analysis.
+ *
+ * Short transforms serve the upper bands with low latency; long ones keep
+ * frequency resolution in the bass. Long windows move little between frames,
+ * so they are refreshed only every `period` frames.
  */
+typedef struct {
+    size_t size;              /**< FFT length (power of 2, <= FFT_SIZE) */
+    unsigned int period;      /**< Recompute every `period` frames */
+    unsigned int countdown;   /**< Frames until the next recompute */
+    const float *window;      /**< Window table the power below belongs to */
+    float windowPower;        /**< Sum of squared window coefficients */
+} ResolutionTier;
+
+// Longest first. Averaged per frame this transforms 1/4 + 1/8 + 1/16 of the
+// points of one FFT_SIZE transform, under half the single-resolution work.
+// Countdowns are staggered so the two long transforms never share a frame.
+static ResolutionTier resolution_tiers[MULTIRES_TIERS] = {
+    {FFT_SIZE, 4, 0, NULL, 0.0f},
+    {FFT_SIZE / 4, 2, 1, NULL, 0.0f},
+    {FFT_SIZE / 16, 1, 0, NULL, 0.0f},
+};
+
+static float multires_bands_rate = 0.0f; // Rate the bands were laid out for
+static size_t band_tier[NUM_BINS];
+static size_t band_bin_start[NUM_BINS];
+static size_t band_bin_end[NUM_BINS];
+static float band_weight[NUM_BINS];
+static float band_amplitude[NUM_BINS];
 
-// Function to process FFT and compute amplitude spectrum
-size_t ProcessFFT(AudioData *audioData) {
-    float dt = GetFrameTime();
+/**
+ * @brief Assign each logarithmic band to the shortest FFT that resolves it.
+ *
+ * A band goes to the shortest transform whose bin spacing still puts at least
+ * two bins inside it, so the band edges and perceptual weights only need to
+ * be computed once per sampling rate.
+ *
+ * @param sampleRate The rate the analysed samples were taken at (Hz).
+ */
+static void init_multi_resolution_bands(float sampleRate) {
+    float minFreq = 20.0f;
+    float maxFreq = 20000.0f;
+    float logMinFreq = log10f(minFreq);
+    float logMaxFreq = log10f(maxFreq);
+    float maxWeight = getMaxPerceptualWeight(minFreq, maxFreq);
+    float weightScalingFactor = 0.5f;
 
-    float tempBuffer[FFT_SIZE];
-    //
-    // Check if audio is playing or in test mode
-    if (!isPlaying && !testMode) {
-        // No audio data to process; set output buffers to zero
-        memset(audioData->out_smooth, 0, sizeof(audioData->out_smooth));
-        return NUM_BINS;
-    }
-
-    if (testMode) {
-        switch (currentTestSignal) {
-        case TEST_SIGNAL_SINE:
-            generateSineWave(tempBuffer, FFT_SIZE, 1000.0f, SAMPLE_RATE);
-            break;
-        case TEST_SIGNAL_MULTI_SINE: {
-            float frequencies[] = {500.0f, 1500.0f};
-            generateMultiSineWave(tempBuffer, FFT_SIZE, frequencies, 2, SAMPLE_RATE);
-            break;
+    for (size_t i = 0; i < NUM_BINS; ++i) {
+        float freqStart = powf(10.0f, logMinFreq + i * (logMaxFreq - logMinFreq) / NUM_BINS);
+        float freqEnd = powf(10.0f, logMinFreq + (i + 1) * (logMaxFreq - logMinFreq) / NUM_BINS);
+        float freqCenter = (freqStart + freqEnd) / 2.0f;
+
+        size_t tier = 0;
+        for (size_t t = MULTIRES_TIERS; t-- > 0;) {
+            float binWidth = sampleRate / resolution_tiers[t].size;
+            if (freqEnd - freqStart >= 2.0f * binWidth) {
+                tier = t;
+                break;
+            }
         }
-        case TEST_SIGNAL_CHIRP:
-            generateChirpSignal(tempBuffer, FFT_SIZE, 20.0f, 20000.0f, SAMPLE_RATE);
-            break;
-        case TEST_SIGNAL_NOISE:
-            generateWhiteNoise(tempBuffer, FFT_SIZE);
-            break;
+
+        size_t halfSize = resolution_tiers[tier].size / 2;
+        size_t binStart = (size_t)((freqStart / (sampleRate / 2.0f)) * halfSize);
+        size_t binEnd = (size_t)((freqEnd / (sampleRate / 2.0f)) * halfSize);
+        if (binEnd > halfSize) binEnd = halfSize;
+        if (binStart >= binEnd) binStart = (binEnd > 0) ? binEnd - 1 : 0;
+        if (binEnd == binStart) binEnd = binStart + 1;
+
+        band_tier[i] = tier;
+        band_bin_start[i] = binStart;
+        band_bin_end[i] = binEnd;
+        band_weight[i] = powf(getPerceptualWeight(freqCenter) / maxWeight, weightScalingFactor);
+        band_amplitude[i] = 0.0f;
+    }
+
+    multires_bands_rate = sampleRate;
+}
+
+/**
+ * @brief Compute the band amplitudes from several FFT lengths.
+ *
+ * @param audioData Pointer to the AudioData structure; in_win and out_raw are
+ * used as scratch space.
+ * @param samples The most recent FFT_SIZE samples, oldest first.
+ *
+ * Every tier transforms the newest `size` samples. Band values are the mean
+ * power per bin normalised by the window energy, which reads the same for a
+ * tone or for noise whichever FFT length produced it, so the bands from
+ * different tiers line up. Tiers that are not due this frame keep their
+ * previous band values.
+ */
+static void compute_multi_resolution_bands(AudioData *audioData, const float samples[]) {
+    if (multires_bands_rate != audioData->sampleRate) {
+        init_multi_resolution_bands(audioData->sampleRate);
+    }
+
+    for (size_t t = 0; t < MULTIRES_TIERS; ++t) {
+        ResolutionTier *tier = &resolution_tiers[t];
+        if (tier->countdown > 0) {
+            tier->countdown--;
+            continue;
         }
-    } else {
-        size_t index = audioData->bufferIndex;
-        for (size_t i = 0; i < FFT_SIZE; ++i) {
-            tempBuffer[i] = audioData->in_raw[(index + i) %FFT_SIZE];
+        tier->countdown = tier->period - 1;
+
+        size_t n = tier->size;
+        const float *window = get_window_table(get_window_function(), n);
+        if (window == NULL) continue;
+
+        if (window != tier->window) {
+            float power = 0.0f;
+            for (size_t i = 0; i < n; ++i) power += window[i] * window[i];
+            tier->window = window;
+            tier->windowPower = power;
         }
-    }
 
+        apply_window(samples + FFT_SIZE - n, audioData->in_win, window, n);
+        fft_transform(audioData->in_win, audioData->out_raw, n);
+
+        for (size_t i = 0; i < NUM_BINS; ++i) {
+            if (band_tier[i] != t) continue;
 
-    // Apply window function
-    apply_window_function(tempBuffer, audioData->in_win, FFT_SIZE);
+            float sum = 0.0f;
+            for (size_t j = band_bin_start[i]; j < band_bin_end[i]; ++j) {
+                float re = crealf(audioData->out_raw[j]);
+                float im = cimagf(audioData->out_raw[j]);
+                sum += re * re + im * im;
+            }
+
+            size_t binCount = band_bin_end[i] - band_bin_start[i];
+            band_amplitude[i] = sqrtf(sum / (binCount * tier->windowPower)) * band_weight[i];
+        }
+    }
 
-    // Perform FFT
-    fft(audioData, FFT_SIZE);
+    memcpy(audioData->out_log, band_amplitude, sizeof(band_amplitude));
+}
 
-    // Compute logarithmically spaced frequency bins
+/**
+ * @brief Average the single-resolution FFT output into logarithmic bands.
+ *
+ * @param audioData Pointer to the AudioData structure holding the FFT output.
+ * @param n The size of the FFT that produced out_raw.
+ *
+ * Each band receives the mean bin magnitude over its frequency range,
+ * scaled by the normalised perceptual weight of its centre frequency.
+ */
+void compute_log_bands(AudioData *audioData, size_t n) {
     size_t numberOfFftBins = NUM_BINS;
     float minFreq = 20.0f;    // Minimum frequency to visualize
     float maxFreq = 20000.0f; // Maximum frequency to visualize
@@ -278,7 +404,7 @@ size_t ProcessFFT(AudioData *audioData) {
     float maxWeight = getMaxPerceptualWeight(minFreq, maxFreq);
     float weightScalingFactor = 0.5f;
 
-    size_t fftSizeOver2 = FFT_SIZE / 2;
+    size_t fftSizeOver2 = n / 2;
 
     for (size_t i = 0; i < numberOfFftBins; ++i) {
         float logFreqStart = logMinFreq + i * (logMaxFreq - logMinFreq) / numberOfFftBins;
@@ -288,8 +414,8 @@ size_t ProcessFFT(AudioData *audioData) {
         float freqEnd = powf(10.0f, logFreqEnd);
         float freqCenter = (freqStart + freqEnd) / 2.0f;
 
-        size_t binStart = (size_t)((freqStart / (SAMPLE_RATE / 2.0f)) * fftSizeOver2);
-        size_t binEnd = (size_t)((freqEnd / (SAMPLE_RATE / 2.0f)) * fftSizeOver2);
+        size_t binStart = (size_t)((freqStart / (audioData->sampleRate / 2.0f)) * fftSizeOver2);
+        size_t binEnd = (size_t)((freqEnd / (audioData->sampleRate / 2.0f)) * fftSizeOver2);
         if (binEnd > fftSizeOver2) binEnd = fftSizeOver2;
         if (binStart >= binEnd) binStart = (binEnd > 0) ? binEnd - 1 : 0;
 
@@ -314,6 +440,55 @@ size_t ProcessFFT(AudioData *audioData) {
             maxAmplitude = binAmplitude;
         }
     }
+}
+
+/**
+ * @brief Compute the band spectrum from the newest FFT_SIZE samples in the
+ * input ring.
+ *
+ * @param audioData Pointer to the AudioData structure containing audio buffers.
+ * @param dt Time since the previous analysis frame, used for smoothing (s).
+ * @return The number of frequency bins computed.
+ *
+ * This is the window, FFT and band pipeline without any dependency on the
+ * window system or playback state, so it can be driven by the render loop
+ * (ProcessFFT) or by a headless tool at its own hop size.
+ */
+size_t analyze_spectrum(AudioData *audioData, float dt) {
+    float tempBuffer[FFT_SIZE];
+
+    PROFILE_BEGIN(PROFILE_ANALYSIS_WINDOW);
+    // Tag the spectrum with the newest sample it covers
+    audioData->spectrumPosition = audioData->samplePosition;
+    size_t index = audioData->bufferIndex;
+    for (size_t i = 0; i < FFT_SIZE; ++i) {
+        tempBuffer[i] = audioData->in_raw[(index + i) %FFT_SIZE];
+    }
+
+    if (currentAnalysisMode == ANALYSIS_MULTI_RESOLUTION) {
+        PROFILE_END(PROFILE_ANALYSIS_WINDOW);
+
+        PROFILE_BEGIN(PROFILE_ANALYSIS_MULTIRES);
+        compute_multi_resolution_bands(audioData, tempBuffer);
+        PROFILE_END(PROFILE_ANALYSIS_MULTIRES);
+    } else {
+        // Apply window function
+        apply_window_function(tempBuffer, audioData->in_win, FFT_SIZE);
+        PROFILE_END(PROFILE_ANALYSIS_WINDOW);
+
+        // Perform FFT
+        PROFILE_BEGIN(PROFILE_ANALYSIS_FFT);
+        fft(audioData, FFT_SIZE);
+        PROFILE_END(PROFILE_ANALYSIS_FFT);
+
+        // Compute logarithmically spaced frequency bins
+        PROFILE_BEGIN(PROFILE_ANALYSIS_BANDS);
+        compute_log_bands(audioData, FFT_SIZE);
+        PROFILE_END(PROFILE_ANALYSIS_BANDS);
+    }
+
+    PROFILE_BEGIN(PROFILE_ANALYSIS_SCALE);
+    size_t numberOfFftBins = NUM_BINS;
 
     // Find the minimum and maximum log values
     float minLogAmplitude = INFINITY;
@@ -333,16 +508,13 @@ size_t ProcessFFT(AudioData *audioData) {
     }
 
     // Apply smoothing
+    // Clamped so long hops (or a stalled frame) settle instead of overshooting
     float smoothness = 10.0f;
+    float alpha = fminf(smoothness * dt, 1.0f);
     for (size_t i = 0; i < numberOfFftBins; ++i) {
-        audioData->out_smooth[i] += (audioData->out_log[i] - audioData->out_smooth[i]) * smoothness * dt;
-    }
-
-    // Add code to print the amplitude spectrum
-    printf("Amplitude Spectrum:\n");
-    for (size_t i = 0; i < numberOfFftBins; ++i) {
-        printf("%zu: %f\n", i, audioData->out_smooth[i]);
+        audioData->out_smooth[i] += (audioData->out_log[i] - audioData->out_smooth[i]) * alpha;
     }
+    PROFILE_END(PROFILE_ANALYSIS_SCALE);
 
     return numberOfFftBins;
 }
@@ -461,6 +633,192 @@ float getMaxPerceptualWeight(float minFreq, float maxFreq) {
     return maxWeight;
 }
 
+// streaming test signal generators
+
+/**
+ * @brief Initialise a recursive sine oscillator.
+ *
+ * @param osc Pointer to the Oscillator to initialise.
+ * @param frequency The oscillator frequency (Hz).
+ * @param sampleRate The sampling rate (Hz).
+ *
+ * The oscillator holds a unit phasor that is rotated by a fixed complex
+ * step per sample, so each output sample is one complex multiply instead of
+ * a sinf call, and the phase carries over between calls.
+ */
+void oscillator_init(Oscillator *osc, float frequency, float sampleRate) {
+    osc->phasor = 1.0f;
+    osc->rotation = cexpf(2.0f * I * M_PI * frequency / sampleRate);
+}
+
+/**
+ * @brief Add the next samples of an oscillator into a buffer.
+ *
+ * @param osc Pointer to the Oscillator.
+ * @param buffer The buffer to accumulate into.
+ * @param length The number of samples to produce.
+ * @param gain Amplitude applied to the oscillator output.
+ */
+void oscillator_mix(Oscillator *osc, float *buffer, size_t length, float gain) {
+    float complex z = osc->phasor;
+    float complex r = osc->rotation;
+    for (size_t i = 0; i < length; ++i) {
+        buffer[i] += gain * cimagf(z);
+        z *= r;
+    }
+    // Pull the phasor back onto the unit circle to stop rounding drift
+    osc->phasor = z / cabsf(z);
+}
+
+/**
+ * @brief Initialise a repeating linear chirp.
+ *
+ * @param chirp Pointer to the ChirpOscillator to initialise.
+ * @param startFreq The starting frequency of each sweep (Hz).
+ * @param endFreq The ending frequency of each sweep (Hz).
+ * @param sweepLength The number of samples per sweep.
+ * @param sampleRate The sampling rate (Hz).
+ *
+ * The per-sample rotation is itself rotated by a constant step, which makes
+ * the instantaneous frequency rise linearly. At the end of a sweep the
+ * frequency returns to startFreq without a phase jump.
+ */
+void chirp_init(ChirpOscillator *chirp, float startFreq, float endFreq, size_t sweepLength, float sampleRate) {
+    chirp->phasor = 1.0f;
+    chirp->startRotation = cexpf(2.0f * I * M_PI * startFreq / sampleRate);
+    chirp->rotation = chirp->startRotation;
+    chirp->sweep = cexpf(2.0f * I * M_PI * (endFreq - startFreq) / sampleRate / sweepLength);
+    chirp->sweepLength = sweepLength;
+    chirp->position = 0;
+}
+
+/**
+ * @brief Write the next samples of a chirp into a buffer.
+ *
+ * @param chirp Pointer to the ChirpOscillator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to produce.
+ */
+void chirp_generate(ChirpOscillator *chirp, float *buffer, size_t length) {
+    float complex z = chirp->phasor;
+    float complex r = chirp->rotation;
+    for (size_t i = 0; i < length; ++i) {
+        buffer[i] = cimagf(z);
+        z *= r;
+        r *= chirp->sweep;
+        if (++chirp->position == chirp->sweepLength) {
+            chirp->position = 0;
+            r = chirp->startRotation;
+        }
+        // Both phasors drift off the unit circle; correct them at fixed
+        // sweep positions so the output does not depend on block sizes
+        if ((chirp->position & 255) == 0) {
+            z /= cabsf(z);
+            r /= cabsf(r);
+        }
+    }
+    chirp->phasor = z;
+    chirp->rotation = r;
+}
+
+/**
+ * @brief Prepare the generator for a test signal type.
+ *
+ * @param gen Pointer to the TestSignalGenerator.
+ * @param type The test signal to produce.
+ * @param sampleRate The sampling rate (Hz).
+ */
+void test_signal_init(TestSignalGenerator *gen, TestSignalType type, float sampleRate) {
+    gen->type = type;
+    gen->sampleRate = sampleRate;
+    gen->pendingSamples = 0.0;
+    gen->toneCount = 0;
+    noise_seed(&gen->noise, NOISE_DEFAULT_SEED);
+
+    switch (type) {
+    case TEST_SIGNAL_SINE:
+        oscillator_init(&gen->tones[0], 1000.0f, sampleRate);
+        gen->toneCount = 1;
+        break;
+    case TEST_SIGNAL_MULTI_SINE:
+        oscillator_init(&gen->tones[0], 500.0f, sampleRate);
+        oscillator_init(&gen->tones[1], 1500.0f, sampleRate);
+        gen->toneCount = 2;
+        break;
+    case TEST_SIGNAL_CHIRP:
+        // One sweep per analysis window, as the block generator produced
+        chirp_init(&gen->chirp, 20.0f, 20000.0f, FFT_SIZE, sampleRate);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Produce the next block of a test signal.
+ *
+ * @param gen Pointer to the TestSignalGenerator.
+ * @param buffer The output buffer.
+ * @param length The number of samples to produce.
+ */
+void test_signal_generate(TestSignalGenerator *gen, float *buffer, size_t length) {
+    switch (gen->type) {
+    case TEST_SIGNAL_SINE:
+    case TEST_SIGNAL_MULTI_SINE:
+        memset(buffer, 0, length * sizeof(float));
+        for (size_t j = 0; j < gen->toneCount; ++j) {
+            oscillator_mix(&gen->tones[j], buffer, length, 1.0f / gen->toneCount);
+        }
+        break;
+    case TEST_SIGNAL_CHIRP:
+        chirp_generate(&gen->chirp, buffer, length);
+        break;
+    case TEST_SIGNAL_NOISE:
+        noise_white(&gen->noise, buffer, length);
+        break;
+    case TEST_SIGNAL_PINK_NOISE:
+        noise_pink(&gen->noise, buffer, length);
+        break;
+    case TEST_SIGNAL_BROWN_NOISE:
+        noise_brown(&gen->noise, buffer, length);
+        break;
+    }
+}
+
+/**
+ * @brief Feed the test signal samples elapsed since the previous frame into
+ * the input ring.
+ *
+ * @param audioData Pointer to the AudioData structure owning the ring.
+ * @param seconds Time elapsed since the previous call.
+ *
+ * The signal enters through write_audio_ring, exactly like audio from the
+ * callback. Fractional samples carry over to the next frame so the stream
+ * runs at the ring's sampling rate. After a stall longer than the ring only the
+ * newest FFT_SIZE samples are generated.
+ */
+void stream_test_signal(AudioData *audioData, float seconds) {
+    if (!testSignalGeneratorReady || testSignalGenerator.type != currentTestSignal ||
+        testSignalGenerator.sampleRate != audioData->sampleRate) {
+        test_signal_init(&testSignalGenerator, currentTestSignal, audioData->sampleRate);
+        testSignalGeneratorReady = true;
+    }
+
+    TestSignalGenerator *gen = &testSignalGenerator;
+    gen->pendingSamples += seconds * gen->sampleRate;
+    size_t count = (size_t)gen->pendingSamples;
+    gen->pendingSamples -= count;
+    if (count > FFT_SIZE) count = FFT_SIZE;
+
+    float block[512];
+    while (count > 0) {
+        size_t n = count < 512 ? count : 512;
+        test_signal_generate(gen, block, n);
+        write_audio_ring(audioData, block, n, 1);
+        count -= n;
+    }
+}
+
 // test signal generation functions
 
 void generateSineWave(float *buffer, size_t length, float frequency, float sampleRate) {
@@ -506,14 +864,18 @@ void generateChirpSignal(float *buffer, size_t length, float startFreq, float en
 }
 
 void generateWhiteNoise(float *buffer, size_t length) {
-    for (size_t i = 0; i < length; ++i) {
-        buffer[i] = ((float)rand() / (float)RAND_MAX) * 2.0f - 1.0f; // Random value between -1 and 1
+    static NoiseGenerator noise;
+    static bool seeded = false;
+    if (!seeded) {
+        noise_seed(&noise, NOISE_DEFAULT_SEED);
+        seeded = true;
     }
+    noise_white(&noise, buffer, length); // Random values between -1 and 1
 }
 
 #ifdef UNIT_TESTING
 float* get_window_coefficients(void) {
-    return window_coefficients;
+    return (float*)window_coefficients;
 }
 
 size_t* get_bit_reversal_indices(void) {
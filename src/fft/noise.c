@@ -0,0 +1,311 @@
+// noise.c
+
+#include "../../include/noise.h"
+#include "../../include/simd.h"
+#include <math.h>
+#include <string.h>
+
+#define NOISE_BLOCK 256
+
+static inline uint32_t rotl32(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static void xoshiro_next(uint32_t s[4]) {
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl32(s[3], 11);
+}
+
+/**
+ * @brief Advance a xoshiro128 state by 2^64 steps.
+ */
+static void xoshiro_jump(uint32_t s[4]) {
+    static const uint32_t jump[4] = {0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b};
+    uint32_t r[4] = {0, 0, 0, 0};
+
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 32; ++b) {
+            if (jump[i] & (1u << b)) {
+                r[0] ^= s[0];
+                r[1] ^= s[1];
+                r[2] ^= s[2];
+                r[3] ^= s[3];
+            }
+            xoshiro_next(s);
+        }
+    }
+    memcpy(s, r, sizeof(r));
+}
+
+void noise_seed(NoiseGenerator *gen, uint64_t seed) {
+    uint32_t lane[4];
+    uint64_t a = splitmix64(&seed);
+    uint64_t b = splitmix64(&seed);
+    lane[0] = (uint32_t)a;
+    lane[1] = (uint32_t)(a >> 32);
+    lane[2] = (uint32_t)b;
+    lane[3] = (uint32_t)(b >> 32);
+
+    for (int l = 0; l < NOISE_LANES; ++l) {
+        for (int w = 0; w < 4; ++w) gen->state[w][l] = lane[w];
+        xoshiro_jump(lane);
+    }
+
+    gen->spareCount = 0;
+    memset(gen->pinkRows, 0, sizeof(gen->pinkRows));
+    gen->pinkHigh = 0.0f;
+    gen->pinkCounter = 0;
+    gen->brown = 0.0f;
+    gen->brownPartial = 0.0f;
+    gen->brownPhase = 0;
+}
+
+// One xoshiro128+ step on four lanes; r receives the output
+#define XOSHIRO_STEP(r, s0, s1, s2, s3) do { \
+        vu4 t_ = vu4_shl(s1, 9); \
+        r = vu4_add(s0, s3); \
+        s2 = vu4_xor(s2, s0); \
+        s3 = vu4_xor(s3, s1); \
+        s1 = vu4_xor(s1, s2); \
+        s0 = vu4_xor(s0, s3); \
+        s2 = vu4_xor(s2, t_); \
+        s3 = vu4_or(vu4_shl(s3, 11), vu4_shr(s3, 21)); \
+    } while (0)
+
+/**
+ * @brief Map the top 23 bits of each lane to a float in [-1, 1).
+ *
+ * The bits become the mantissa of a float in [1, 2), which is then shifted
+ * and scaled; no integer-to-float conversion or division is needed.
+ */
+static inline vf4 bits_to_unit(vu4 r) {
+    vf4 f = vu4_as_vf4(vu4_or(vu4_shr(r, 9), vu4_set1(0x3F800000u)));
+    return vf4_sub(vf4_mul(f, vf4_set1(2.0f)), vf4_set1(3.0f));
+}
+
+void noise_white(NoiseGenerator *gen, float *buffer, size_t length) {
+    // Samples the previous call stepped past but did not use come first, so
+    // the stream does not depend on where calls split it
+    size_t i = 0;
+    while (i < length && gen->spareCount > 0) {
+        buffer[i++] = gen->spare[NOISE_LANES - gen->spareCount--];
+    }
+    if (i == length) return;
+
+    // Two independent 4-lane groups keep both vector pipes busy
+    vu4 a0 = vu4_load(&gen->state[0][0]), b0 = vu4_load(&gen->state[0][4]);
+    vu4 a1 = vu4_load(&gen->state[1][0]), b1 = vu4_load(&gen->state[1][4]);
+    vu4 a2 = vu4_load(&gen->state[2][0]), b2 = vu4_load(&gen->state[2][4]);
+    vu4 a3 = vu4_load(&gen->state[3][0]), b3 = vu4_load(&gen->state[3][4]);
+    vu4 ra, rb;
+
+    for (; i + NOISE_LANES <= length; i += NOISE_LANES) {
+        XOSHIRO_STEP(ra, a0, a1, a2, a3);
+        XOSHIRO_STEP(rb, b0, b1, b2, b3);
+        vf4_store(buffer + i, bits_to_unit(ra));
+        vf4_store(buffer + i + 4, bits_to_unit(rb));
+    }
+
+    if (i < length) {
+        XOSHIRO_STEP(ra, a0, a1, a2, a3);
+        XOSHIRO_STEP(rb, b0, b1, b2, b3);
+        vf4_store(gen->spare, bits_to_unit(ra));
+        vf4_store(gen->spare + 4, bits_to_unit(rb));
+        memcpy(buffer + i, gen->spare, (length - i) * sizeof(float));
+        gen->spareCount = (uint32_t)(NOISE_LANES - (length - i));
+    }
+
+    vu4_store(&gen->state[0][0], a0); vu4_store(&gen->state[0][4], b0);
+    vu4_store(&gen->state[1][0], a1); vu4_store(&gen->state[1][4], b1);
+    vu4_store(&gen->state[2][0], a2); vu4_store(&gen->state[2][4], b2);
+    vu4_store(&gen->state[3][0], a3); vu4_store(&gen->state[3][4], b3);
+}
+
+static inline float clamp_unit(float x) {
+    return x > 1.0f ? 1.0f : (x < -1.0f ? -1.0f : x);
+}
+
+static inline unsigned int count_trailing_zeros(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_ctz(x);
+#else
+    unsigned int n = 0;
+    while ((x & 1u) == 0) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @brief Voss-McCartney pink noise.
+ *
+ * Row k is refreshed every 2^(k+1) samples, chosen by the trailing zeros of
+ * a running counter, so each sample updates at most one row. The rows plus a
+ * fresh white sample sum to a -3 dB/octave spectrum. Every sample takes two
+ * white values, the first for its row and the second added on top.
+ *
+ * Inside a run of 8 samples starting at a multiple of 8 the schedule is
+ * fixed: rows 0-2 change at known positions and a single higher row changes
+ * on the last sample. Aligned runs are therefore computed without per-sample
+ * branching or a serial dependency on a running sum; only unaligned heads
+ * and tails take the per-sample path. Both paths add the rows above 2, rows
+ * 0-2 and the white value in the same order, so the output is identical
+ * wherever calls split the stream.
+ */
+void noise_pink(NoiseGenerator *gen, float *buffer, size_t length) {
+    float white[2 * NOISE_BLOCK];
+    const float scale = 1.0f / (NOISE_PINK_ROWS + 1);
+    float *rows = gen->pinkRows;
+    float high = gen->pinkHigh;
+
+    while (length > 0) {
+        size_t n = length < NOISE_BLOCK ? length : NOISE_BLOCK;
+        noise_white(gen, white, 2 * n);
+
+        size_t i = 0;
+        while (i < n) {
+            if ((gen->pinkCounter & 7u) == 0 && n - i >= 8) {
+                // Even entries refresh rows, odd entries are added on top
+                const float *w = &white[2 * i];
+                float r1 = rows[1];
+                float r2 = rows[2];
+
+                float *out = buffer + i;
+                out[0] = (high + w[0] + r1 + r2 + w[1]) * scale;
+                out[1] = (high + w[0] + w[2] + r2 + w[3]) * scale;
+                out[2] = (high + w[4] + w[2] + r2 + w[5]) * scale;
+                out[3] = (high + w[4] + w[2] + w[6] + w[7]) * scale;
+                out[4] = (high + w[8] + w[2] + w[6] + w[9]) * scale;
+                out[5] = (high + w[8] + w[10] + w[6] + w[11]) * scale;
+                out[6] = (high + w[12] + w[10] + w[6] + w[13]) * scale;
+
+                gen->pinkCounter += 8;
+                if (gen->pinkCounter != 0) {
+                    unsigned int row = count_trailing_zeros(gen->pinkCounter);
+                    if (row < NOISE_PINK_ROWS) {
+                        high += w[14] - rows[row];
+                        rows[row] = w[14];
+                    }
+                }
+                out[7] = (high + w[12] + w[10] + w[6] + w[15]) * scale;
+
+                rows[0] = w[12];
+                rows[1] = w[10];
+                rows[2] = w[6];
+                i += 8;
+                continue;
+            }
+
+            uint32_t counter = ++gen->pinkCounter;
+            if (counter != 0) {
+                unsigned int row = count_trailing_zeros(counter);
+                if (row < 3) {
+                    rows[row] = white[2 * i];
+                } else if (row < NOISE_PINK_ROWS) {
+                    high += white[2 * i] - rows[row];
+                    rows[row] = white[2 * i];
+                }
+            }
+            buffer[i] = (high + rows[0] + rows[1] + rows[2] + white[2 * i + 1]) * scale;
+            ++i;
+        }
+
+        buffer += n;
+        length -= n;
+    }
+    gen->pinkHigh = high;
+}
+
+/**
+ * @brief One sample of a four-sample brown noise group.
+ *
+ * Computes exactly what the unrolled group computes for the same position:
+ * the input integrated since the group started, plus the decayed state from
+ * before the group. The state moves on once the group is complete.
+ */
+static inline float brown_step(float *y, float *p, uint32_t *phase, const float decay[4], float u) {
+    *p = decay[0] * *p + u;
+    float out = decay[*phase] * *y + *p;
+    if (++*phase == 4) {
+        *y = out;
+        *p = 0.0f;
+        *phase = 0;
+    }
+    return out;
+}
+
+/**
+ * @brief Brown noise from a leaky integrator over white noise.
+ *
+ * The leak keeps the walk bounded without a DC build-up; the output gain
+ * brings it to roughly the level of the other noise types.
+ *
+ * The recursion is unrolled four samples at a time: every output of a group
+ * is formed directly from the state before the group, so the only serial
+ * dependency is one multiply-add per four samples. Groups are counted from
+ * the start of the stream and a group split across calls is finished with
+ * the same arithmetic, so the split does not change the output.
+ */
+void noise_brown(NoiseGenerator *gen, float *buffer, size_t length) {
+    float white[NOISE_BLOCK];
+    const float a = 1.0f / 1.02f;
+    const float c = 0.02f / 1.02f * 3.5f; // Input gain with the output gain folded in
+    const float a2 = a * a, a3 = a2 * a, a4 = a3 * a;
+    const float decay[4] = {a, a2, a3, a4};
+
+    float y = gen->brown;
+    float p = gen->brownPartial;
+    uint32_t phase = gen->brownPhase;
+    while (length > 0) {
+        size_t n = length < NOISE_BLOCK ? length : NOISE_BLOCK;
+        noise_white(gen, white, n);
+
+        // Finish the group the previous call left open
+        size_t i = 0;
+        for (; i < n && phase != 0; ++i) {
+            buffer[i] = clamp_unit(brown_step(&y, &p, &phase, decay, c * white[i]));
+        }
+        for (; i + 4 <= n; i += 4) {
+            float u0 = c * white[i];
+            float u1 = c * white[i + 1];
+            float u2 = c * white[i + 2];
+            float u3 = c * white[i + 3];
+            float p1 = a * u0 + u1;
+            float p2 = a * p1 + u2;
+            float p3 = a * p2 + u3;
+
+            float y0 = a * y + u0;
+            float y1 = a2 * y + p1;
+            float y2 = a3 * y + p2;
+            y = a4 * y + p3;
+
+            buffer[i] = clamp_unit(y0);
+            buffer[i + 1] = clamp_unit(y1);
+            buffer[i + 2] = clamp_unit(y2);
+            buffer[i + 3] = clamp_unit(y);
+        }
+        for (; i < n; ++i) {
+            buffer[i] = clamp_unit(brown_step(&y, &p, &phase, decay, c * white[i]));
+        }
+
+        buffer += n;
+        length -= n;
+    }
+    gen->brown = y;
+    gen->brownPartial = p;
+    gen->brownPhase = phase;
+}
@@ -0,0 +1,94 @@
+// process.c
+//
+// Glue between the analysis pipeline and the running application: the
+// audio stream processor and the per-frame entry point used by the render
+// loop. Everything here depends on raylib or on playback state; the DSP
+// itself lives in fft.c.
+
+#include "../../include/fft.h"
+#include "../../include/playback.h"
+#include "../../include/profiler.h"
+#include "../../include/latency.h"
+#include "../../include/alloc_tracker.h"
+#include <stdio.h>
+#include <string.h>
+#include <raylib.h>
+
+#define NUM_BINS 64
+
+static AudioData *audioDataPtr = NULL;
+
+/**
+ * @brief Set the global pointer to teh AudioData structure for use in callbacks.
+ *
+ * @param audioData Pointer to the AudioData structure to set.
+ *
+ * This function sets the global `audioDataPtr` to the provided AudioData
+ * pointer, allowing teh callback function to access and modify audio data.
+ */
+void set_audio_data(AudioData *audioData) {
+    audioDataPtr = audioData;
+}
+
+/**
+ * @brief Audio processing callback function for handling incoming audio data.
+ *
+ * @param bufferData Pointer to the buffer containing audio frames.
+ * @praram frames The number of frames in the buffer.
+ *
+ * This function is called whenever new audio data is available. It copies
+ * the audio data into the `in_raw` buffer of the AudioData structure for
+ * further processing
+ */
+void callback(void *bufferData, unsigned int frames) {
+    if (audioDataPtr == NULL) return;
+
+    // Check if audio is playing; in test mode the signal generator owns the ring
+    if (!isPlaying || testMode) {
+        // Do not write to the buffer
+        return;
+    }
+
+    ALLOC_TRACKER_NAME_THREAD("audio");
+    PROFILE_BEGIN(PROFILE_AUDIO_CALLBACK);
+    // Assuming mono input: take the left channel of each stereo frame
+    write_audio_ring(audioDataPtr, (const float *)bufferData, frames, 2);
+    latency_note_callback(audioDataPtr->samplePosition, frames);
+    PROFILE_END(PROFILE_AUDIO_CALLBACK);
+}
+
+/**
+ * @brief Process the FFT and compute the amplitude specturm for visualization
+ * @param audioData Pointer to the AudioData structure containing audio buffers
+ * @return The number of frequency bins computed
+ *
+ * This function handles the processing of audio data for visualization:
+ * it streams the test signal when test mode is active and then runs
+ * analyze_spectrum with the frame time of the render loop.
+ */
+size_t ProcessFFT(AudioData *audioData) {
+    float dt = GetFrameTime();
+
+    // Check if audio is playing or in test mode
+    if (!isPlaying && !testMode) {
+        // No audio data to process; set output buffers to zero
+        memset(audioData->out_smooth, 0, sizeof(audioData->out_smooth));
+        return NUM_BINS;
+    }
+
+    if (testMode) {
+        stream_test_signal(audioData, dt);
+    }
+
+    size_t numberOfFftBins = analyze_spectrum(audioData, dt);
+
+#ifdef PRINT_SPECTRUM
+    // Debug dump; 65 writes to stdout per frame, so off by default
+    printf("Amplitude Spectrum:\n");
+    for (size_t i = 0; i < numberOfFftBins; ++i) {
+        printf("%zu: %f\n", i, audioData->out_smooth[i]);
+    }
+#endif
+
+    return numberOfFftBins;
+}
@@ -0,0 +1,141 @@
+// window.c
+
+#include "../../include/window.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define KAISER_BETA 9.0
+#define GAUSSIAN_SIGMA 0.4
+
+typedef struct WindowTable {
+    WindowType type;
+    size_t size;
+    float *coefficients;
+    struct WindowTable *next;
+} WindowTable;
+
+// Built tables, most recently created first
+static WindowTable *window_tables = NULL;
+
+/**
+ * @brief Zeroth-order modified Bessel function of the first kind.
+ *
+ * Power series evaluation; converges in a few dozen terms for the beta
+ * values used by the Kaiser window.
+ */
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x / 2.0;
+    for (int k = 1; k < 64; ++k) {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static void fill_window(WindowType type, float *w, size_t size) {
+    // A single-point window is the identity
+    if (size == 1) {
+        w[0] = 1.0f;
+        return;
+    }
+
+    double denominator = (double)(size - 1);
+    double i0Beta = bessel_i0(KAISER_BETA);
+
+    for (size_t i = 0; i < size; ++i) {
+        double t = i / denominator;
+        double value;
+        switch (type) {
+        case WINDOW_HANN:
+            value = 0.5 - 0.5 * cos(2.0 * M_PI * t);
+            break;
+        case WINDOW_BLACKMAN_HARRIS:
+            value = 0.35875 - 0.48829 * cos(2.0 * M_PI * t)
+                  + 0.14128 * cos(4.0 * M_PI * t)
+                  - 0.01168 * cos(6.0 * M_PI * t);
+            break;
+        case WINDOW_KAISER: {
+            double r = 2.0 * t - 1.0;
+            value = bessel_i0(KAISER_BETA * sqrt(1.0 - r * r)) / i0Beta;
+            break;
+        }
+        case WINDOW_FLAT_TOP:
+            value = 0.21557895 - 0.41663158 * cos(2.0 * M_PI * t)
+                  + 0.277263158 * cos(4.0 * M_PI * t)
+                  - 0.083578947 * cos(6.0 * M_PI * t)
+                  + 0.006947368 * cos(8.0 * M_PI * t);
+            break;
+        case WINDOW_GAUSSIAN: {
+            double r = (i - denominator / 2.0) / (GAUSSIAN_SIGMA * denominator / 2.0);
+            value = exp(-0.5 * r * r);
+            break;
+        }
+        default:
+            value = 1.0;
+            break;
+        }
+        w[i] = (float)value;
+    }
+}
+
+const float* get_window_table(WindowType type, size_t size) {
+    for (WindowTable *table = window_tables; table != NULL; table = table->next) {
+        if (table->type == type && table->size == size) {
+            return table->coefficients;
+        }
+    }
+
+    if (size == 0 || (unsigned int)type >= WINDOW_TYPE_COUNT) {
+        fprintf(stderr, "Error: Invalid window request (type %d, size %zu).\n", (int)type, size);
+        return NULL;
+    }
+
+    WindowTable *table = (WindowTable*)malloc(sizeof(WindowTable));
+    float *coefficients = (float*)malloc(size * sizeof(float));
+    if (!table || !coefficients) {
+        fprintf(stderr, "Failed to allocate memory for window table.\n");
+        free(table);
+        free(coefficients);
+        return NULL;
+    }
+
+    fill_window(type, coefficients, size);
+
+    table->type = type;
+    table->size = size;
+    table->coefficients = coefficients;
+    table->next = window_tables;
+    window_tables = table;
+
+    return coefficients;
+}
+
+void apply_window(const float input[], float output[], const float window[], size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        output[i] = input[i] * window[i];
+    }
+}
+
+const char* window_name(WindowType type) {
+    switch (type) {
+    case WINDOW_HANN: return "Hann";
+    case WINDOW_BLACKMAN_HARRIS: return "Blackman-Harris";
+    case WINDOW_KAISER: return "Kaiser";
+    case WINDOW_FLAT_TOP: return "Flat-Top";
+    case WINDOW_GAUSSIAN: return "Gaussian";
+    default: return "Unknown";
+    }
+}
+
+void free_window_tables(void) {
+    while (window_tables != NULL) {
+        WindowTable *next = window_tables->next;
+        free(window_tables->coefficients);
+        free(window_tables);
+        window_tables = next;
+    }
+}
@@ -0,0 +1,105 @@
+// latency.c
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../../include/latency.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+// Records this close to being overwritten are skipped by the reader
+#define LATENCY_GUARD 4
+
+static LatencyMonitor *latencyMonitorPtr = NULL;
+
+void latency_init(LatencyMonitor *monitor, float sampleRate, size_t ringSize) {
+    memset(monitor, 0, sizeof(*monitor));
+    monitor->sampleRate = sampleRate;
+    monitor->ringSize = ringSize;
+}
+
+uint64_t latency_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void latency_record_callback(LatencyMonitor *monitor, uint64_t time, uint64_t position, unsigned int frames) {
+    uint64_t count = monitor->callbackCount;
+    CallbackRecord *record = &monitor->callbacks[count % LATENCY_HISTORY];
+    record->time = time;
+    record->position = position;
+    record->frames = frames;
+    __atomic_store_n(&monitor->callbackCount, count + 1, __ATOMIC_RELEASE);
+}
+
+void latency_update(LatencyMonitor *monitor, uint64_t spectrumPosition, uint64_t drawTime) {
+    uint64_t count = __atomic_load_n(&monitor->callbackCount, __ATOMIC_ACQUIRE);
+    uint64_t available = count < LATENCY_HISTORY - LATENCY_GUARD ? count : LATENCY_HISTORY - LATENCY_GUARD;
+    uint64_t first = count - available;
+
+    // Fresh input since the previous spectrum; more than one window means
+    // samples went through the ring without ever being analysed
+    monitor->freshSamples = spectrumPosition - monitor->lastSpectrumPosition;
+    monitor->ringFill = (float)monitor->freshSamples / (float)monitor->ringSize;
+    monitor->lastSpectrumPosition = spectrumPosition;
+
+    // The spectrum's centre lags its newest sample by half a window
+    monitor->windowDelayMs = 0.5f * (float)monitor->ringSize / monitor->sampleRate * 1000.0f;
+
+    // Arrival time of the newest analysed sample
+    monitor->latencyValid = false;
+    for (uint64_t i = count; i > first; --i) {
+        const CallbackRecord *record = &monitor->callbacks[(i - 1) % LATENCY_HISTORY];
+        if (record->position < spectrumPosition) break;
+        if (record->position - record->frames < spectrumPosition) {
+            monitor->arrivalToDrawMs = (float)((double)(drawTime - record->time) * 1e-6);
+            monitor->latencyValid = true;
+            break;
+        }
+    }
+
+    monitor->valid = available >= 3;
+    if (!monitor->valid) return;
+
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double expectedSum = 0.0;
+    double maxDeviation = 0.0;
+    double frameSum = 0.0;
+    size_t intervals = 0;
+
+    for (uint64_t i = first + 1; i < count; ++i) {
+        const CallbackRecord *previous = &monitor->callbacks[(i - 1) % LATENCY_HISTORY];
+        const CallbackRecord *current = &monitor->callbacks[i % LATENCY_HISTORY];
+
+        double interval = (double)(current->time - previous->time) * 1e-6;
+        double expected = (double)current->frames / monitor->sampleRate * 1000.0;
+        double deviation = fabs(interval - expected);
+
+        sum += interval;
+        sumSquares += interval * interval;
+        expectedSum += expected;
+        frameSum += current->frames;
+        if (deviation > maxDeviation) maxDeviation = deviation;
+        intervals++;
+    }
+
+    double mean = sum / intervals;
+    double variance = sumSquares / intervals - mean * mean;
+
+    monitor->intervalMs = (float)mean;
+    monitor->expectedIntervalMs = (float)(expectedSum / intervals);
+    monitor->jitterMs = (float)sqrt(variance > 0.0 ? variance : 0.0);
+    monitor->maxDeviationMs = (float)maxDeviation;
+    monitor->callbackFrames = (float)(frameSum / intervals);
+}
+
+void set_latency_monitor(LatencyMonitor *monitor) {
+    latencyMonitorPtr = monitor;
+}
+
+void latency_note_callback(uint64_t position, unsigned int frames) {
+    if (latencyMonitorPtr == NULL) return;
+    latency_record_callback(latencyMonitorPtr, latency_now_ns(), position, frames);
+}
@@ -0,0 +1,172 @@
+// library.c
+//
+// The media library in a few flat arrays. Albums sit in one growing array
+// and are found by name through an open-addressing table with linear
+// probing, kept at most half full; each album holds its songs in one array
+// of its own. Names and paths are copied into a single arena, unless they
+// already sit in a borrowed block such as the mapped library index, and a
+// song's file name is the tail of its path, so adding a song costs no
+// allocation of its own and no string is stored twice.
+
+#include "../../include/library.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIBRARY_INITIAL_SLOTS 64
+#define LIBRARY_INITIAL_ALBUMS 32
+#define LIBRARY_INITIAL_SONGS 8
+
+void library_init(Library *library) {
+    memset(library, 0, sizeof(*library));
+}
+
+void library_borrow(Library *library, const char *block, size_t size) {
+    library->borrowed = size > 0 && size <= LIBRARY_BORROWED ? block : NULL;
+    library->borrowedSize = library->borrowed != NULL ? size : 0;
+}
+
+// Offset of a string: in place if it lies in the borrowed block, otherwise
+// of a copy in the arena; STRING_ARENA_NONE if out of memory
+static size_t store_string(Library *library, const char *string) {
+    uintptr_t address = (uintptr_t)string;
+    uintptr_t block = (uintptr_t)library->borrowed;
+    if (library->borrowed != NULL && address >= block && address - block < library->borrowedSize) {
+        return (size_t)(address - block) | LIBRARY_BORROWED;
+    }
+
+    size_t offset = string_arena_add(&library->strings, string);
+    return offset < LIBRARY_BORROWED ? offset : STRING_ARENA_NONE;
+}
+
+void library_free(Library *library) {
+    for (size_t i = 0; i < library->albumCount; ++i) {
+        free(library->albums[i].songs);
+    }
+    free(library->albums);
+    free(library->slots);
+    string_arena_free(&library->strings);
+    library_init(library);
+}
+
+// FNV-1a, folded to 32 bits
+static uint32_t hash_name(const char *name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; ++c) {
+        hash = (hash ^ *c) * 1099511628211ull;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// Slot holding the album, or the empty slot where it would go
+static size_t find_slot(const Library *library, const char *name, uint32_t hash) {
+    size_t mask = library->slotCount - 1;
+    size_t slot = hash & mask;
+    while (library->slots[slot] != 0) {
+        const LibraryAlbum *album = &library->albums[library->slots[slot] - 1];
+        if (album->hash == hash && strcmp(library_string(library, album->name), name) == 0) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static bool grow_slots(Library *library) {
+    size_t slotCount = library->slotCount > 0 ? library->slotCount * 2 : LIBRARY_INITIAL_SLOTS;
+    uint32_t *slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+    if (slots == NULL) return false;
+
+    free(library->slots);
+    library->slots = slots;
+    library->slotCount = slotCount;
+
+    // Names are distinct, so each album goes to the first free slot on its probe
+    size_t mask = slotCount - 1;
+    for (size_t i = 0; i < library->albumCount; ++i) {
+        size_t slot = library->albums[i].hash & mask;
+        while (slots[slot] != 0) slot = (slot + 1) & mask;
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    return true;
+}
+
+size_t library_find_album(const Library *library, const char *name) {
+    if (library->slotCount == 0) return LIBRARY_NONE;
+    uint32_t id = library->slots[find_slot(library, name, hash_name(name))];
+    return id != 0 ? (size_t)id - 1 : LIBRARY_NONE;
+}
+
+size_t library_add_album(Library *library, const char *name) {
+    uint32_t hash = hash_name(name);
+
+    if ((library->albumCount + 1) * 2 > library->slotCount && !grow_slots(library)) {
+        fprintf(stderr, "Failed to grow the album index past %zu albums\n", library->albumCount);
+        return LIBRARY_NONE;
+    }
+    size_t slot = find_slot(library, name, hash);
+    if (library->slots[slot] != 0) return (size_t)library->slots[slot] - 1;
+
+    if (library->albumCount == library->albumCapacity) {
+        size_t capacity = library->albumCapacity > 0 ? library->albumCapacity * 2 : LIBRARY_INITIAL_ALBUMS;
+        LibraryAlbum *albums = capacity < UINT32_MAX ?
+            (LibraryAlbum *)realloc(library->albums, capacity * sizeof(LibraryAlbum)) : NULL;
+        if (albums == NULL) {
+            fprintf(stderr, "Failed to grow the library past %zu albums\n", library->albumCount);
+            return LIBRARY_NONE;
+        }
+        library->albums = albums;
+        library->albumCapacity = capacity;
+    }
+
+    size_t nameOffset = store_string(library, name);
+    if (nameOffset == STRING_ARENA_NONE) return LIBRARY_NONE;
+
+    size_t id = library->albumCount++;
+    LibraryAlbum *album = &library->albums[id];
+    memset(album, 0, sizeof(*album));
+    album->name = (uint32_t)nameOffset;
+    album->hash = hash;
+    library->slots[slot] = (uint32_t)(id + 1);
+    return id;
+}
+
+bool library_add_song(Library *library, const char *album, const char *name, const char *path) {
+    size_t id = library_add_album(library, album);
+    if (id == LIBRARY_NONE) return false;
+
+    LibraryAlbum *entry = &library->albums[id];
+    if (entry->songCount == entry->songCapacity) {
+        size_t capacity = entry->songCapacity > 0 ? entry->songCapacity * 2 : LIBRARY_INITIAL_SONGS;
+        LibrarySong *songs = (LibrarySong *)realloc(entry->songs, capacity * sizeof(LibrarySong));
+        if (songs == NULL) {
+            fprintf(stderr, "Failed to grow album %s past %zu songs\n", album, entry->songCount);
+            return false;
+        }
+        entry->songs = songs;
+        entry->songCapacity = capacity;
+    }
+
+    size_t pathOffset = store_string(library, path);
+    if (pathOffset == STRING_ARENA_NONE) return false;
+
+    // The file name is normally the end of the path; share it
+    size_t pathLength = strlen(path);
+    size_t nameLength = strlen(name);
+    size_t nameOffset = pathOffset + pathLength - nameLength;
+    if (nameLength > pathLength || strcmp(path + pathLength - nameLength, name) != 0) {
+        nameOffset = store_string(library, name);
+    }
+    if (nameOffset == STRING_ARENA_NONE) return false;
+
+    LibrarySong *song = &entry->songs[entry->songCount++];
+    song->name = (uint32_t)nameOffset;
+    song->path = (uint32_t)pathOffset;
+    return true;
+}
+
+size_t library_song_count(const Library *library) {
+    size_t count = 0;
+    for (size_t i = 0; i < library->albumCount; ++i) {
+        count += library->albums[i].songCount;
+    }
+    return count;
+}
@@ -0,0 +1,625 @@
+// library_index.c
+//
+// On-disk index of the media library, so that a launch with an unchanged
+// library lists no directories at all. The file is a header, fixed-size
+// directory and song records and one block of NUL-terminated strings, all
+// native-endian and naturally aligned, so it is read straight from a
+// read-only mapping:
+//
+//   IndexHeader | IndexDirectory[directoryCount] | IndexSong[songCount] | strings
+//
+// Directories are sorted by path and own a contiguous run of songs. A
+// directory's modification time changes whenever an entry is added,
+// removed or renamed in it, so one stat per directory tells whether its
+// records still hold. A song edited in place keeps its record; the track
+// cache compares size and time again when it is played.
+//
+// Songs of unchanged directories are reported with strings that point into
+// the mapping, which the caller may keep mapped and point at in turn, so
+// an unchanged library is loaded without copying a string. Only when the
+// index is rewritten are those runs copied, straight into the new file.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/library_index.h"
+#include "../../include/string_arena.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC "BBLIBIDX"
+#define INDEX_BYTE_ORDER 0x01020304u
+#define INDEX_GONE INT64_MIN         // Validated time of a directory that no longer exists
+#define INDEX_PARALLEL_MIN 64        // Fewer directories are validated on the calling thread
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;              /**< INDEX_BYTE_ORDER as written */
+    uint32_t directoryCount;
+    uint32_t songCount;
+    uint64_t stringBytes;
+    uint32_t root;                   /**< Media directory the index describes */
+    uint32_t reserved;
+} IndexHeader;
+
+typedef struct {
+    int64_t modified;                /**< Directory modification time (ns) */
+    uint32_t path;
+    uint32_t firstSong;
+    uint32_t songCount;
+    uint32_t reserved;
+} IndexDirectory;
+
+typedef struct {
+    uint64_t size;
+    int64_t modified;
+    uint32_t path;                   /**< The directory's path, a slash and the name */
+    uint32_t name;                   /**< Tail of the path */
+    uint32_t directory;
+    uint32_t reserved;
+} IndexSong;
+
+/**
+ * @brief A mapped index that passed validation.
+ */
+typedef struct {
+    void *data;
+    size_t size;
+    const IndexHeader *header;
+    const IndexDirectory *directories;
+    const IndexSong *songs;
+    const char *strings;
+} MappedIndex;
+
+typedef struct {
+    size_t path;                     /**< Offset in the builder's arena */
+    int64_t modified;
+} BuiltDirectory;
+
+typedef struct {
+    size_t path;                     /**< Offset in the builder's arena */
+    size_t name;                     /**< Start of the file name within the path */
+    uint64_t size;
+    int64_t modified;
+    uint32_t directory;              /**< Assigned when saving */
+} BuiltSong;
+
+/**
+ * @brief Directories listed on this launch, saved with the unchanged ones
+ * as the next index.
+ */
+typedef struct {
+    StringArena strings;
+    BuiltDirectory *directories;
+    size_t directoryCount;
+    size_t directoryCapacity;
+    BuiltSong *songs;
+    size_t songCount;
+    size_t songCapacity;
+    bool failed;                     /**< Out of memory; the result must not be saved */
+} IndexBuilder;
+
+/**
+ * @brief State of one library_index_load.
+ */
+typedef struct {
+    const LibraryScanVisitor *visitor;
+    const char *root;
+    const MappedIndex *index;        /**< NULL while rebuilding */
+    IndexBuilder builder;
+    char **added;                    /**< New subdirectories of changed directories */
+    size_t addedCount;
+    size_t addedCapacity;
+    LibraryIndexStats *stats;
+} IndexLoad;
+
+/**
+ * @brief Directories validated by one thread.
+ */
+typedef struct {
+    const MappedIndex *index;
+    int64_t *modified;
+    uint32_t first;
+    uint32_t end;
+} ValidateSlice;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool grow(void **items, size_t *capacity, size_t count, size_t itemSize) {
+    if (count < *capacity) return true;
+    size_t next = *capacity > 0 ? *capacity * 2 : 256;
+    void *grown = realloc(*items, next * itemSize);
+    if (grown == NULL) return false;
+    *items = grown;
+    *capacity = next;
+    return true;
+}
+
+static const char* album_of(const char *root, const char *path) {
+    if (strcmp(path, root) == 0) return NULL;
+    const char *slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+static void unmap_index(MappedIndex *index) {
+    if (index->data != NULL) munmap(index->data, index->size);
+    memset(index, 0, sizeof(*index));
+}
+
+static bool reject_index(MappedIndex *index, const char *path, const char *reason) {
+    fprintf(stderr, "Ignoring library index %s: %s\n", path, reason);
+    unmap_index(index);
+    return false;
+}
+
+static bool map_index(const char *path, const char *root, MappedIndex *index) {
+    memset(index, 0, sizeof(*index));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false; // First launch
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+        close(fd);
+        fprintf(stderr, "Ignoring library index %s: truncated\n", path);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map library index %s\n", path);
+        return false;
+    }
+    index->data = data;
+    index->size = (size_t)st.st_size;
+
+    const IndexHeader *header = (const IndexHeader *)data;
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != LIBRARY_INDEX_VERSION || header->byteOrder != INDEX_BYTE_ORDER) {
+        return reject_index(index, path, "unknown format");
+    }
+
+    uint64_t expected = sizeof(IndexHeader) + (uint64_t)header->directoryCount * sizeof(IndexDirectory) +
+                        (uint64_t)header->songCount * sizeof(IndexSong) + header->stringBytes;
+    if (expected != index->size) return reject_index(index, path, "size mismatch");
+
+    index->header = header;
+    index->directories = (const IndexDirectory *)(header + 1);
+    index->songs = (const IndexSong *)(index->directories + header->directoryCount);
+    index->strings = (const char *)(index->songs + header->songCount);
+
+    // Every offset in bounds and every string terminated inside the block
+    uint64_t bytes = header->stringBytes;
+    if (bytes == 0 || index->strings[bytes - 1] != '\0' || header->root >= bytes) {
+        return reject_index(index, path, "damaged strings");
+    }
+    if (strcmp(index->strings + header->root, root) != 0) {
+        return reject_index(index, path, "made for another media directory");
+    }
+    for (uint32_t i = 0; i < header->directoryCount; ++i) {
+        const IndexDirectory *directory = &index->directories[i];
+        if (directory->path >= bytes ||
+            (uint64_t)directory->firstSong + directory->songCount > header->songCount ||
+            (i > 0 && strcmp(index->strings + index->directories[i - 1].path, index->strings + directory->path) >= 0)) {
+            return reject_index(index, path, "damaged directories");
+        }
+    }
+    for (uint32_t i = 0; i < header->songCount; ++i) {
+        const IndexSong *song = &index->songs[i];
+        if (song->path >= bytes || song->name < song->path || song->name >= bytes ||
+            song->directory >= header->directoryCount) {
+            return reject_index(index, path, "damaged songs");
+        }
+    }
+    return true;
+}
+
+static bool find_directory(const MappedIndex *index, const char *path) {
+    size_t low = 0;
+    size_t high = index->header->directoryCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int order = strcmp(index->strings + index->directories[middle].path, path);
+        if (order == 0) return true;
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+static void* validate_thread(void *arg) {
+    ValidateSlice *slice = (ValidateSlice *)arg;
+    for (uint32_t i = slice->first; i < slice->end; ++i) {
+        struct stat st;
+        const char *path = slice->index->strings + slice->index->directories[i].path;
+        slice->modified[i] = stat(path, &st) == 0 && S_ISDIR(st.st_mode) ? library_scan_modified(&st) : INDEX_GONE;
+    }
+    return NULL;
+}
+
+// One stat per directory, split over threads: on a network share these
+// round trips are all the startup cost of an unchanged library
+static void validate_directories(const MappedIndex *index, int64_t *modified) {
+    uint32_t count = index->header->directoryCount;
+    ValidateSlice slices[LIBRARY_SCAN_WORKERS];
+    pthread_t threads[LIBRARY_SCAN_WORKERS];
+    bool started[LIBRARY_SCAN_WORKERS] = { false };
+
+    int workers = count < INDEX_PARALLEL_MIN ? 1 : LIBRARY_SCAN_WORKERS;
+    for (int i = 0; i < workers; ++i) {
+        slices[i].index = index;
+        slices[i].modified = modified;
+        slices[i].first = (uint32_t)((uint64_t)count * i / workers);
+        slices[i].end = (uint32_t)((uint64_t)count * (i + 1) / workers);
+        started[i] = i > 0 && pthread_create(&threads[i], NULL, validate_thread, &slices[i]) == 0;
+    }
+    for (int i = 0; i < workers; ++i) {
+        if (!started[i]) validate_thread(&slices[i]);
+    }
+    for (int i = 1; i < workers; ++i) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+}
+
+static void add_scan_stats(LibraryScanStats *total, const LibraryScanStats *scan) {
+    total->directories += scan->directories;
+    total->files += scan->files;
+    total->songs += scan->songs;
+    total->seconds += scan->seconds;
+}
+
+static void on_directory(void *context, const char *path, int64_t modified) {
+    IndexBuilder *builder = &((IndexLoad *)context)->builder;
+    size_t offset = string_arena_add(&builder->strings, path);
+    if (offset == STRING_ARENA_NONE ||
+        !grow((void **)&builder->directories, &builder->directoryCapacity, builder->directoryCount, sizeof(BuiltDirectory))) {
+        builder->failed = true;
+        return;
+    }
+    builder->directories[builder->directoryCount].path = offset;
+    builder->directories[builder->directoryCount].modified = modified;
+    builder->directoryCount++;
+}
+
+static void report_song(IndexLoad *load, const LibraryScanSong *song) {
+    load->stats->songs++;
+    if (load->visitor->song != NULL) load->visitor->song(load->visitor->context, song);
+}
+
+static void on_song(void *context, const LibraryScanSong *song) {
+    IndexLoad *load = (IndexLoad *)context;
+    IndexBuilder *builder = &load->builder;
+    report_song(load, song);
+
+    size_t offset = string_arena_add(&builder->strings, song->path);
+    if (offset == STRING_ARENA_NONE ||
+        !grow((void **)&builder->songs, &builder->songCapacity, builder->songCount, sizeof(BuiltSong))) {
+        builder->failed = true;
+        return;
+    }
+    BuiltSong *built = &builder->songs[builder->songCount++];
+    built->path = offset;
+    built->name = strlen(song->path) - strlen(song->name);
+    built->size = song->size;
+    built->modified = song->modified;
+}
+
+static void on_subdirectory(void *context, const char *path) {
+    IndexLoad *load = (IndexLoad *)context;
+    if (find_directory(load->index, path)) return; // Validated on its own
+
+    char *copy = (char *)malloc(strlen(path) + 1);
+    if (copy == NULL || !grow((void **)&load->added, &load->addedCapacity, load->addedCount, sizeof(char *))) {
+        free(copy);
+        load->builder.failed = true;
+        return;
+    }
+    strcpy(copy, path);
+    load->added[load->addedCount++] = copy;
+}
+
+// Songs of an unchanged directory, pointing into the mapping; nothing is
+// copied unless the index gets rewritten
+static void reuse_directory(IndexLoad *load, uint32_t index) {
+    const MappedIndex *mapped = load->index;
+    const IndexDirectory *directory = &mapped->directories[index];
+
+    LibraryScanSong song;
+    song.album = album_of(load->root, mapped->strings + directory->path);
+    for (uint32_t i = directory->firstSong; i < directory->firstSong + directory->songCount; ++i) {
+        const IndexSong *record = &mapped->songs[i];
+        song.path = mapped->strings + record->path;
+        song.name = mapped->strings + record->name;
+        song.size = record->size;
+        song.modified = record->modified;
+        report_song(load, &song);
+    }
+}
+
+static bool is_reused(const MappedIndex *index, const int64_t *modified, uint32_t directory) {
+    return index != NULL && modified[directory] == index->directories[directory].modified;
+}
+
+// qsort has no context argument; saving runs on one thread at a time
+static const char *sortStrings;
+
+static int compare_directories(const void *a, const void *b) {
+    return strcmp(sortStrings + ((const BuiltDirectory *)a)->path, sortStrings + ((const BuiltDirectory *)b)->path);
+}
+
+static int compare_songs(const void *a, const void *b) {
+    const BuiltSong *x = (const BuiltSong *)a;
+    const BuiltSong *y = (const BuiltSong *)b;
+    if (x->directory != y->directory) return x->directory < y->directory ? -1 : 1;
+    return strcmp(sortStrings + x->path + x->name, sortStrings + y->path + y->name);
+}
+
+static int compare_directory_key(const void *key, const void *item) {
+    return strcmp((const char *)key, sortStrings + ((const BuiltDirectory *)item)->path);
+}
+
+// Adds a song's path and points its record at it; the name is the path's tail
+static bool add_song_path(StringArena *strings, IndexSong *record, const char *path, size_t nameStart) {
+    size_t offset = string_arena_add(strings, path);
+    record->path = (uint32_t)offset;
+    record->name = (uint32_t)(offset + nameStart);
+    return offset != STRING_ARENA_NONE;
+}
+
+// Writes the directories listed on this launch merged with the unchanged
+// ones of the old index, whose runs are copied from the mapping as they go
+static bool write_index(const char *indexPath, const char *root, IndexBuilder *builder,
+                        const MappedIndex *index, const int64_t *modified) {
+    sortStrings = builder->strings.data;
+    qsort(builder->directories, builder->directoryCount, sizeof(BuiltDirectory), compare_directories);
+
+    // A directory reached twice keeps its first record
+    size_t unique = 0;
+    for (size_t i = 0; i < builder->directoryCount; ++i) {
+        if (unique == 0 || compare_directories(&builder->directories[unique - 1], &builder->directories[i]) != 0) {
+            builder->directories[unique++] = builder->directories[i];
+        }
+    }
+    builder->directoryCount = unique;
+
+    // File each song under its directory
+    char key[LIBRARY_SCAN_PATH_MAX];
+    size_t kept = 0;
+    for (size_t i = 0; i < builder->songCount; ++i) {
+        BuiltSong *song = &builder->songs[i];
+        if (song->name == 0 || song->name > sizeof(key)) continue;
+        memcpy(key, sortStrings + song->path, song->name - 1);
+        key[song->name - 1] = '\0';
+
+        const BuiltDirectory *directory = (const BuiltDirectory *)bsearch(
+            key, builder->directories, builder->directoryCount, sizeof(BuiltDirectory), compare_directory_key);
+        if (directory == NULL) continue;
+        song->directory = (uint32_t)(directory - builder->directories);
+        builder->songs[kept++] = *song;
+    }
+    builder->songCount = kept;
+    qsort(builder->songs, builder->songCount, sizeof(BuiltSong), compare_songs);
+
+    uint32_t oldCount = index != NULL ? index->header->directoryCount : 0;
+    size_t directoryLimit = builder->directoryCount;
+    size_t songLimit = builder->songCount;
+    for (uint32_t i = 0; i < oldCount; ++i) {
+        if (!is_reused(index, modified, i)) continue;
+        directoryLimit++;
+        songLimit += index->directories[i].songCount;
+    }
+
+    // Only the strings the file refers to
+    StringArena strings = { 0 };
+    IndexDirectory *directories = (IndexDirectory *)calloc(directoryLimit + 1, sizeof(IndexDirectory));
+    IndexSong *songs = (IndexSong *)calloc(songLimit + 1, sizeof(IndexSong));
+    size_t rootOffset = string_arena_add(&strings, root);
+    bool ok = directories != NULL && songs != NULL && rootOffset != STRING_ARENA_NONE &&
+              directoryLimit <= UINT32_MAX && songLimit <= UINT32_MAX;
+
+    // Both lists are sorted by path; on a tie the fresh listing wins
+    size_t directoryCount = 0;
+    size_t songCount = 0;
+    size_t built = 0;
+    size_t builtSong = 0;
+    uint32_t old = 0;
+    while (ok && (built < builder->directoryCount || old < oldCount)) {
+        if (old < oldCount && !is_reused(index, modified, old)) {
+            old++;
+            continue;
+        }
+        const char *oldPath = old < oldCount ? index->strings + index->directories[old].path : NULL;
+        const char *builtPath = built < builder->directoryCount ? sortStrings + builder->directories[built].path : NULL;
+        int order = oldPath == NULL ? 1 : (builtPath == NULL ? -1 : strcmp(oldPath, builtPath));
+
+        IndexDirectory *directory = &directories[directoryCount];
+        directory->firstSong = (uint32_t)songCount;
+        if (order < 0) {
+            const IndexDirectory *record = &index->directories[old++];
+            size_t offset = string_arena_add(&strings, oldPath);
+            directory->path = (uint32_t)offset;
+            directory->modified = record->modified;
+            ok = offset != STRING_ARENA_NONE;
+
+            for (uint32_t i = record->firstSong; ok && i < record->firstSong + record->songCount; ++i) {
+                const IndexSong *from = &index->songs[i];
+                IndexSong *song = &songs[songCount++];
+                ok = add_song_path(&strings, song, index->strings + from->path, from->name - from->path);
+                song->directory = (uint32_t)directoryCount;
+                song->size = from->size;
+                song->modified = from->modified;
+            }
+        } else {
+            if (order == 0) old++;
+            size_t offset = string_arena_add(&strings, builtPath);
+            directory->path = (uint32_t)offset;
+            directory->modified = builder->directories[built].modified;
+            ok = offset != STRING_ARENA_NONE;
+
+            for (; ok && builtSong < builder->songCount && builder->songs[builtSong].directory == built; ++builtSong) {
+                const BuiltSong *from = &builder->songs[builtSong];
+                IndexSong *song = &songs[songCount++];
+                ok = add_song_path(&strings, song, sortStrings + from->path, from->name);
+                song->directory = (uint32_t)directoryCount;
+                song->size = from->size;
+                song->modified = from->modified;
+            }
+            built++;
+        }
+        directory->songCount = (uint32_t)(songCount - directory->firstSong);
+        directoryCount++;
+    }
+    ok = ok && strings.length <= UINT32_MAX;
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = LIBRARY_INDEX_VERSION;
+    header.byteOrder = INDEX_BYTE_ORDER;
+    header.directoryCount = (uint32_t)directoryCount;
+    header.songCount = (uint32_t)songCount;
+    header.stringBytes = strings.length;
+    header.root = (uint32_t)rootOffset;
+
+    // Written aside and renamed over the old index, which is still mapped
+    char temporary[LIBRARY_SCAN_PATH_MAX];
+    ok = ok && snprintf(temporary, sizeof(temporary), "%s.tmp", indexPath) < (int)sizeof(temporary);
+    FILE *file = ok ? fopen(temporary, "wb") : NULL;
+    if (file != NULL) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(directories, sizeof(IndexDirectory), directoryCount, file) == directoryCount &&
+             fwrite(songs, sizeof(IndexSong), songCount, file) == songCount &&
+             fwrite(strings.data, 1, strings.length, file) == strings.length;
+        ok = fclose(file) == 0 && ok;
+        ok = ok && rename(temporary, indexPath) == 0;
+        if (!ok) remove(temporary);
+    } else {
+        ok = false;
+    }
+    if (!ok) fprintf(stderr, "Failed to save library index %s\n", indexPath);
+
+    free(directories);
+    free(songs);
+    string_arena_free(&strings);
+    return ok;
+}
+
+bool library_index_load(const char *indexPath, const char *root, const LibraryScanVisitor *visitor,
+                        LibraryIndexStats *stats, LibraryIndexMapping *mapping) {
+    double start = now_seconds();
+
+    LibraryIndexStats ignored;
+    if (stats == NULL) stats = &ignored;
+    memset(stats, 0, sizeof(*stats));
+    if (mapping != NULL) memset(mapping, 0, sizeof(*mapping));
+
+    IndexLoad load;
+    memset(&load, 0, sizeof(load));
+    load.visitor = visitor;
+    load.root = root;
+    load.stats = stats;
+
+    MappedIndex index;
+    int64_t *modified = NULL;
+    bool changed = false;
+    bool opened = true;
+    size_t reused = 0;
+    LibraryScanStats scan;
+
+    if (!map_index(indexPath, root, &index)) {
+        LibraryScanVisitor full = { on_song, on_directory, NULL, NULL, &load, NULL };
+        opened = library_scan(root, &full, true, &scan);
+        if (opened) {
+            add_scan_stats(&stats->scan, &scan);
+            stats->rescanned = scan.directories;
+        }
+        stats->rebuilt = true;
+        changed = true;
+    } else {
+        load.index = &index;
+        uint32_t count = index.header->directoryCount;
+        modified = (int64_t *)malloc((count + 1) * sizeof(int64_t));
+        if (modified == NULL) {
+            fprintf(stderr, "Failed to allocate library index validation\n");
+            unmap_index(&index);
+            return false;
+        }
+        validate_directories(&index, modified);
+
+        // Songs of unchanged directories point into the mapping; a visitor
+        // that wants to keep those pointers gets it left mapped
+        if (mapping != NULL && visitor->strings != NULL) {
+            visitor->strings(visitor->context, index.strings, (size_t)index.header->stringBytes);
+        }
+
+        opened = false;
+        for (uint32_t i = 0; i < count; ++i) {
+            const char *path = index.strings + index.directories[i].path;
+            if (modified[i] != INDEX_GONE && strcmp(path, root) == 0) opened = true;
+
+            if (modified[i] == INDEX_GONE) {
+                changed = true;
+            } else if (is_reused(&index, modified, i)) {
+                reuse_directory(&load, i);
+                reused++;
+            } else {
+                // Entries came or went: list this directory alone; its
+                // subdirectories are validated on their own or, if new, scanned
+                LibraryScanVisitor shallow = { on_song, on_directory, on_subdirectory, NULL, &load, album_of(root, path) };
+                if (library_scan(path, &shallow, false, &scan)) {
+                    add_scan_stats(&stats->scan, &scan);
+                    stats->rescanned++;
+                }
+                changed = true;
+            }
+        }
+
+        for (size_t i = 0; i < load.addedCount; ++i) {
+            LibraryScanVisitor full = { on_song, on_directory, NULL, NULL, &load, album_of(root, load.added[i]) };
+            if (library_scan(load.added[i], &full, true, &scan)) {
+                add_scan_stats(&stats->scan, &scan);
+                stats->rescanned += scan.directories;
+            }
+            free(load.added[i]);
+        }
+        free(load.added);
+    }
+
+    stats->directories = reused + load.builder.directoryCount;
+    if (opened && changed && !load.builder.failed) {
+        stats->written = write_index(indexPath, root, &load.builder, load.index, modified);
+    }
+
+    if (mapping != NULL && visitor->strings != NULL && index.data != NULL) {
+        mapping->data = index.data;
+        mapping->size = index.size;
+    } else {
+        unmap_index(&index);
+    }
+    free(modified);
+    string_arena_free(&load.builder.strings);
+    free(load.builder.directories);
+    free(load.builder.songs);
+    stats->seconds = now_seconds() - start;
+    return opened;
+}
+
+void library_index_unmap(LibraryIndexMapping *mapping) {
+    if (mapping->data != NULL) munmap(mapping->data, mapping->size);
+    memset(mapping, 0, sizeof(*mapping));
+}
@@ -0,0 +1,317 @@
+// library_scan.c
+//
+// Parallel walk of the media directory. Listing a large library over a
+// network share is dominated by round trips, so several workers list
+// directories at once. Each worker keeps its own deque of directories still
+// to list: it pushes the subdirectories it finds and pops the newest one
+// (depth first, close to what it just read), and when it runs dry it steals
+// the oldest directory of another worker, usually the top of a large
+// unexplored subtree. Entry types come from readdir's d_type; only entries
+// it cannot classify (symlinks, file systems that leave it unknown) and the
+// songs themselves, for their size and time, cost an fstatat relative to
+// the open directory.
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE   // d_type and DT_* on glibc
+#endif
+#define _DARWIN_C_SOURCE  // and on macOS
+
+#include "../../include/library_scan.h"
+#include "../../include/alloc_tracker.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define SCAN_DEQUE_INITIAL_CAPACITY 64
+#define SCAN_IDLE_NS 100000       // Back-off of a worker with nothing to steal
+
+/**
+ * @brief A directory waiting to be listed.
+ */
+typedef struct {
+    char *path;                   /**< Owned; freed once listed */
+    size_t albumOffset;           /**< Start of the directory's own name in path; 0 for the root */
+} ScanDirectory;
+
+/**
+ * @brief One worker's directories. The owner works at the newest end,
+ * thieves at the oldest.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    ScanDirectory *items;
+    size_t head;                  /**< Oldest item */
+    size_t count;
+    size_t capacity;
+} ScanDeque;
+
+typedef struct LibraryScan LibraryScan;
+
+typedef struct {
+    LibraryScan *scan;
+    int index;
+    uint64_t directories;
+    uint64_t files;
+    uint64_t songs;
+    char path[LIBRARY_SCAN_PATH_MAX]; /**< Path of the entry being looked at */
+} ScanWorker;
+
+struct LibraryScan {
+    ScanDeque deques[LIBRARY_SCAN_WORKERS];
+    ScanWorker workers[LIBRARY_SCAN_WORKERS];
+    size_t pending;               /**< Directories queued or being listed */
+    const LibraryScanVisitor *visitor;
+    bool recursive;
+    pthread_mutex_t visitLock;
+};
+
+int64_t library_scan_modified(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool deque_push(ScanDeque *deque, ScanDirectory item) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        size_t capacity = deque->capacity > 0 ? deque->capacity * 2 : SCAN_DEQUE_INITIAL_CAPACITY;
+        ScanDirectory *items = (ScanDirectory *)malloc(capacity * sizeof(ScanDirectory));
+        if (items == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+        for (size_t i = 0; i < deque->count; ++i) {
+            items[i] = deque->items[(deque->head + i) % deque->capacity];
+        }
+        free(deque->items);
+        deque->items = items;
+        deque->head = 0;
+        deque->capacity = capacity;
+    }
+    deque->items[(deque->head + deque->count) % deque->capacity] = item;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+static bool deque_pop(ScanDeque *deque, ScanDirectory *item) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        *item = deque->items[(deque->head + deque->count) % deque->capacity];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool deque_steal(ScanDeque *deque, ScanDirectory *item) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *item = deque->items[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool is_song(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot != NULL && dot != name && (strcmp(dot, ".wav") == 0 || strcmp(dot, ".mp3") == 0);
+}
+
+// Follows symlinks, as stat() does
+static bool is_directory(DIR *dir, const struct dirent *entry) {
+#ifdef DT_DIR
+    if (entry->d_type == DT_DIR) return true;
+    if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) return false;
+#endif
+    struct stat st;
+    return fstatat(dirfd(dir), entry->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+}
+
+static bool list_directory(ScanWorker *worker, const ScanDirectory *directory) {
+    LibraryScan *scan = worker->scan;
+    const LibraryScanVisitor *visitor = scan->visitor;
+
+    DIR *dir = opendir(directory->path);
+    if (dir == NULL) {
+        fprintf(stderr, "Failed to open directory %s\n", directory->path);
+        return false;
+    }
+    worker->directories++;
+
+    // Taken before listing, so an entry added meanwhile shows as a change next time
+    struct stat st;
+    if (visitor->directory != NULL && fstat(dirfd(dir), &st) == 0) {
+        pthread_mutex_lock(&scan->visitLock);
+        visitor->directory(visitor->context, directory->path, library_scan_modified(&st));
+        pthread_mutex_unlock(&scan->visitLock);
+    }
+
+    size_t length = strlen(directory->path);
+    const char *album = directory->albumOffset > 0 ? directory->path + directory->albumOffset : visitor->rootAlbum;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        size_t nameLength = strlen(name);
+        if (length + nameLength + 2 > LIBRARY_SCAN_PATH_MAX) {
+            fprintf(stderr, "Skipping %s/%s: path too long\n", directory->path, name);
+            continue;
+        }
+        memcpy(worker->path, directory->path, length);
+        worker->path[length] = '/';
+        memcpy(worker->path + length + 1, name, nameLength + 1);
+
+        if (is_directory(dir, entry)) {
+            if (!scan->recursive) {
+                if (visitor->subdirectory != NULL) {
+                    pthread_mutex_lock(&scan->visitLock);
+                    visitor->subdirectory(visitor->context, worker->path);
+                    pthread_mutex_unlock(&scan->visitLock);
+                }
+                continue;
+            }
+
+            ScanDirectory child = { (char *)malloc(length + nameLength + 2), length + 1 };
+            if (child.path == NULL) {
+                fprintf(stderr, "Failed to queue directory %s\n", worker->path);
+                continue;
+            }
+            memcpy(child.path, worker->path, length + nameLength + 2);
+
+            // Counted before it is visible, so pending cannot reach zero early
+            __atomic_add_fetch(&scan->pending, 1, __ATOMIC_ACQ_REL);
+            if (!deque_push(&scan->deques[worker->index], child)) {
+                fprintf(stderr, "Failed to queue directory %s\n", worker->path);
+                __atomic_sub_fetch(&scan->pending, 1, __ATOMIC_ACQ_REL);
+                free(child.path);
+            }
+            continue;
+        }
+
+        worker->files++;
+        if (is_song(name) && fstatat(dirfd(dir), name, &st, 0) == 0) {
+            LibraryScanSong song = { album, name, worker->path, (uint64_t)st.st_size, library_scan_modified(&st) };
+            worker->songs++;
+            if (visitor->song != NULL) {
+                pthread_mutex_lock(&scan->visitLock);
+                visitor->song(visitor->context, &song);
+                pthread_mutex_unlock(&scan->visitLock);
+            }
+        }
+    }
+
+    closedir(dir);
+    return true;
+}
+
+static void* scan_thread(void *arg) {
+    ScanWorker *worker = (ScanWorker *)arg;
+    LibraryScan *scan = worker->scan;
+    const struct timespec idle = { 0, SCAN_IDLE_NS };
+    ALLOC_TRACKER_NAME_WORKER("scan");
+
+    for (;;) {
+        ScanDirectory directory;
+        bool found = deque_pop(&scan->deques[worker->index], &directory);
+        for (int i = 1; !found && i < LIBRARY_SCAN_WORKERS; ++i) {
+            found = deque_steal(&scan->deques[(worker->index + i) % LIBRARY_SCAN_WORKERS], &directory);
+        }
+
+        if (found) {
+            list_directory(worker, &directory);
+            free(directory.path);
+            __atomic_sub_fetch(&scan->pending, 1, __ATOMIC_ACQ_REL);
+        } else if (__atomic_load_n(&scan->pending, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        } else {
+            // Others are still listing and may yet push work
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+bool library_scan(const char *root, const LibraryScanVisitor *visitor, bool recursive, LibraryScanStats *stats) {
+    double start = now_seconds();
+    if (stats != NULL) memset(stats, 0, sizeof(*stats));
+
+    // Heap allocated: the workers' path buffers are too large for the stack
+    LibraryScan *scan = (LibraryScan *)calloc(1, sizeof(LibraryScan));
+    if (scan == NULL) {
+        fprintf(stderr, "Failed to allocate the library scan\n");
+        return false;
+    }
+    scan->visitor = visitor;
+    scan->recursive = recursive;
+    pthread_mutex_init(&scan->visitLock, NULL);
+    for (int i = 0; i < LIBRARY_SCAN_WORKERS; ++i) {
+        pthread_mutex_init(&scan->deques[i].lock, NULL);
+        scan->workers[i].scan = scan;
+        scan->workers[i].index = i;
+    }
+
+    // The root is listed here, seeding the first deque for the workers to split up
+    ScanDirectory top = { (char *)malloc(strlen(root) + 1), 0 };
+    bool opened = top.path != NULL;
+    if (opened) {
+        strcpy(top.path, root);
+        opened = list_directory(&scan->workers[0], &top);
+        free(top.path);
+    }
+
+    if (opened && recursive) {
+        pthread_t threads[LIBRARY_SCAN_WORKERS];
+        int started = 0;
+        for (int i = 0; i < LIBRARY_SCAN_WORKERS; ++i) {
+            if (pthread_create(&threads[started], NULL, scan_thread, &scan->workers[i]) != 0) {
+                fprintf(stderr, "Failed to start scan worker %d\n", i);
+                break;
+            }
+            started++;
+        }
+        // Workers steal from every deque, so any number of them finishes the walk
+        if (started == 0) scan_thread(&scan->workers[0]);
+        for (int i = 0; i < started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    if (stats != NULL) {
+        for (int i = 0; i < LIBRARY_SCAN_WORKERS; ++i) {
+            stats->directories += scan->workers[i].directories;
+            stats->files += scan->workers[i].files;
+            stats->songs += scan->workers[i].songs;
+        }
+        stats->seconds = now_seconds() - start;
+    }
+
+    for (int i = 0; i < LIBRARY_SCAN_WORKERS; ++i) {
+        pthread_mutex_destroy(&scan->deques[i].lock);
+        free(scan->deques[i].items);
+    }
+    pthread_mutex_destroy(&scan->visitLock);
+    free(scan);
+    return opened;
+}
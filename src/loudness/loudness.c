@@ -0,0 +1,298 @@
+// loudness.c
+
+#include "../../include/loudness.h"
+#include "../../include/simd.h"
+#include "../../include/profiler.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LOUDNESS_ABSOLUTE_GATE -70.0f
+#define LOUDNESS_RELATIVE_GATE -10.0f
+#define LOUDNESS_HISTOGRAM_STEP 0.1f
+#define LOUDNESS_OFFSET -0.691f
+
+// ITU-R BS.1770-4 Annex 2 interpolation filter, stored tap-major so that one
+// vector holds tap k of all four phases.
+static const float true_peak_coefficients[TRUE_PEAK_TAPS][TRUE_PEAK_PHASES] = {
+    { 0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f},
+    { 0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f},
+    {-0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f},
+    { 0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f},
+    {-0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f},
+    { 0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f},
+    { 0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f},
+    {-0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f},
+    { 0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f},
+    {-0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f},
+    { 0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f},
+    {-0.0083007812500f, -0.0189208984375f, -0.0291748046875f,  0.0017089843750f},
+};
+
+// Mean-square energy represented by the centre of each histogram bin
+static double histogram_energy[LOUDNESS_HISTOGRAM_BINS];
+static bool histogram_energy_ready = false;
+
+static LoudnessMeter *loudnessMeterPtr = NULL;
+
+static float energy_to_lufs(double energy) {
+    if (energy <= 0.0) return -INFINITY;
+    return LOUDNESS_OFFSET + 10.0f * (float)log10(energy);
+}
+
+static void compute_histogram_energy(void) {
+    for (size_t i = 0; i < LOUDNESS_HISTOGRAM_BINS; ++i) {
+        double lufs = LOUDNESS_ABSOLUTE_GATE + (i + 0.5) * LOUDNESS_HISTOGRAM_STEP;
+        histogram_energy[i] = pow(10.0, (lufs - LOUDNESS_OFFSET) / 10.0);
+    }
+    histogram_energy_ready = true;
+}
+
+/**
+ * @brief Design the two K-weighting stages for an arbitrary sampling rate.
+ *
+ * The analog prototypes from BS.1770 are mapped through the bilinear
+ * transform, which reproduces the published 48 kHz coefficients exactly and
+ * keeps the response correct at 44.1, 88.2 and 96 kHz.
+ */
+static void design_k_weighting(Biquad *shelf, Biquad *highpass, double sampleRate) {
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+
+    double k = tan(M_PI * f0 / sampleRate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+
+    shelf->b0 = (vh + vb * k / q + k * k) / a0;
+    shelf->b1 = 2.0 * (k * k - vh) / a0;
+    shelf->b2 = (vh - vb * k / q + k * k) / a0;
+    shelf->a1 = 2.0 * (k * k - 1.0) / a0;
+    shelf->a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sampleRate);
+    a0 = 1.0 + k / q + k * k;
+
+    highpass->b0 = 1.0;
+    highpass->b1 = -2.0;
+    highpass->b2 = 1.0;
+    highpass->a1 = 2.0 * (k * k - 1.0) / a0;
+    highpass->a2 = (1.0 - k / q + k * k) / a0;
+}
+
+static inline double biquad_process(Biquad *bq, double x) {
+    double y = bq->b0 * x + bq->z1;
+    bq->z1 = bq->b1 * x - bq->a1 * y + bq->z2;
+    bq->z2 = bq->b2 * x - bq->a2 * y;
+    return y;
+}
+
+void loudness_init(LoudnessMeter *meter, float sampleRate) {
+    if (!histogram_energy_ready) {
+        compute_histogram_energy();
+    }
+
+    memset(meter, 0, sizeof(*meter));
+    meter->sampleRate = sampleRate;
+    meter->subBlockLength = (size_t)(sampleRate / 10.0f + 0.5f);
+
+    for (size_t ch = 0; ch < LOUDNESS_CHANNELS; ++ch) {
+        design_k_weighting(&meter->shelf[ch], &meter->highpass[ch], sampleRate);
+    }
+
+    loudness_reset(meter);
+}
+
+void loudness_reset(LoudnessMeter *meter) {
+    for (size_t ch = 0; ch < LOUDNESS_CHANNELS; ++ch) {
+        meter->shelf[ch].z1 = meter->shelf[ch].z2 = 0.0;
+        meter->highpass[ch].z1 = meter->highpass[ch].z2 = 0.0;
+    }
+
+    meter->subBlockFill = 0;
+    meter->subBlockEnergy = 0.0;
+    meter->subBlockIndex = 0;
+    meter->subBlockCount = 0;
+    memset(meter->subBlocks, 0, sizeof(meter->subBlocks));
+    memset(meter->histogram, 0, sizeof(meter->histogram));
+    memset(meter->tpHistory, 0, sizeof(meter->tpHistory));
+    meter->tpPosition = 0;
+    meter->tpBlockPeak = 0.0f;
+
+    meter->momentary = -INFINITY;
+    meter->shortTerm = -INFINITY;
+    meter->integrated = -INFINITY;
+    meter->truePeak = -INFINITY;
+    meter->maxTruePeak = -INFINITY;
+    meter->resetRequested = false;
+}
+
+void loudness_request_reset(LoudnessMeter *meter) {
+    meter->resetRequested = true;
+}
+
+/**
+ * @brief Two-pass gated mean over the block histogram (BS.1770-4 section 2.8).
+ */
+static float compute_integrated(const LoudnessMeter *meter) {
+    double sum = 0.0;
+    unsigned long count = 0;
+    for (size_t i = 0; i < LOUDNESS_HISTOGRAM_BINS; ++i) {
+        sum += meter->histogram[i] * histogram_energy[i];
+        count += meter->histogram[i];
+    }
+    if (count == 0) return -INFINITY;
+
+    float relativeGate = energy_to_lufs(sum / count) + LOUDNESS_RELATIVE_GATE;
+    float gateBin = (relativeGate - LOUDNESS_ABSOLUTE_GATE) / LOUDNESS_HISTOGRAM_STEP;
+    size_t start = gateBin > 0.0f ? (size_t)ceilf(gateBin) : 0;
+
+    sum = 0.0;
+    count = 0;
+    for (size_t i = start; i < LOUDNESS_HISTOGRAM_BINS; ++i) {
+        sum += meter->histogram[i] * histogram_energy[i];
+        count += meter->histogram[i];
+    }
+    if (count == 0) return -INFINITY;
+
+    return energy_to_lufs(sum / count);
+}
+
+static void finish_sub_block(LoudnessMeter *meter) {
+    meter->subBlocks[meter->subBlockIndex] = meter->subBlockEnergy / meter->subBlockLength;
+    meter->subBlockIndex = (meter->subBlockIndex + 1) % LOUDNESS_SUBBLOCKS;
+    if (meter->subBlockCount < LOUDNESS_SUBBLOCKS) meter->subBlockCount++;
+    meter->subBlockEnergy = 0.0;
+    meter->subBlockFill = 0;
+
+    // Sum the most recent sub-blocks; the first four form the momentary window
+    double momentarySum = 0.0;
+    double shortTermSum = 0.0;
+    for (size_t i = 0; i < meter->subBlockCount; ++i) {
+        size_t index = (meter->subBlockIndex + LOUDNESS_SUBBLOCKS - 1 - i) % LOUDNESS_SUBBLOCKS;
+        if (i < LOUDNESS_MOMENTARY_BLOCKS) momentarySum += meter->subBlocks[index];
+        shortTermSum += meter->subBlocks[index];
+    }
+
+    if (meter->subBlockCount >= LOUDNESS_MOMENTARY_BLOCKS) {
+        meter->momentary = energy_to_lufs(momentarySum / LOUDNESS_MOMENTARY_BLOCKS);
+
+        // Every momentary window is also a 75%-overlapped gating block
+        if (meter->momentary >= LOUDNESS_ABSOLUTE_GATE) {
+            size_t bin = (size_t)((meter->momentary - LOUDNESS_ABSOLUTE_GATE) / LOUDNESS_HISTOGRAM_STEP);
+            if (bin >= LOUDNESS_HISTOGRAM_BINS) bin = LOUDNESS_HISTOGRAM_BINS - 1;
+            meter->histogram[bin]++;
+            meter->integrated = compute_integrated(meter);
+        }
+    }
+    // Like momentary, short-term waits for its whole 3 s window
+    if (meter->subBlockCount == LOUDNESS_SUBBLOCKS) {
+        meter->shortTerm = energy_to_lufs(shortTermSum / LOUDNESS_SUBBLOCKS);
+    }
+
+    meter->truePeak = meter->tpBlockPeak > 0.0f ? 20.0f * log10f(meter->tpBlockPeak) : -INFINITY;
+    if (meter->truePeak > meter->maxTruePeak) meter->maxTruePeak = meter->truePeak;
+    meter->tpBlockPeak = 0.0f;
+}
+
+/**
+ * @brief 4x polyphase true-peak detector over a run of frames.
+ *
+ * Each input sample produces four interpolated outputs. With the taps stored
+ * phase-interleaved, one vector multiply-add per tap evaluates all four
+ * phases at once, so a sample costs twelve vector FMAs per channel.
+ */
+static void true_peak_process(LoudnessMeter *meter, const float *frames, size_t frameCount) {
+    vf4 taps[TRUE_PEAK_TAPS];
+    for (size_t k = 0; k < TRUE_PEAK_TAPS; ++k) {
+        taps[k] = vf4_load(true_peak_coefficients[k]);
+    }
+
+    vf4 peak = vf4_zero();
+    size_t position = meter->tpPosition;
+
+    for (size_t ch = 0; ch < LOUDNESS_CHANNELS; ++ch) {
+        float *history = meter->tpHistory[ch];
+        position = meter->tpPosition;
+
+        for (size_t i = 0; i < frameCount; ++i) {
+            // Newest sample first; the mirror copy keeps the window contiguous
+            position = (position + TRUE_PEAK_TAPS - 1) % TRUE_PEAK_TAPS;
+            float x = frames[i * LOUDNESS_CHANNELS + ch];
+            history[position] = x;
+            history[position + TRUE_PEAK_TAPS] = x;
+
+            const float *window = &history[position];
+            vf4 acc = vf4_zero();
+            for (size_t k = 0; k < TRUE_PEAK_TAPS; ++k) {
+                acc = vf4_madd(acc, taps[k], vf4_set1(window[k]));
+            }
+            peak = vf4_max(peak, vf4_abs(acc));
+        }
+    }
+
+    meter->tpPosition = position;
+    float blockPeak = vf4_hmax(peak);
+    if (blockPeak > meter->tpBlockPeak) meter->tpBlockPeak = blockPeak;
+}
+
+void loudness_process(LoudnessMeter *meter, const float *frames, size_t frameCount) {
+    while (frameCount > 0) {
+        size_t run = meter->subBlockLength - meter->subBlockFill;
+        if (run > frameCount) run = frameCount;
+
+        // K-weighting and energy accumulation
+        double energy = 0.0;
+        for (size_t i = 0; i < run; ++i) {
+            for (size_t ch = 0; ch < LOUDNESS_CHANNELS; ++ch) {
+                double y = biquad_process(&meter->shelf[ch], frames[i * LOUDNESS_CHANNELS + ch]);
+                y = biquad_process(&meter->highpass[ch], y);
+                energy += y * y;
+            }
+        }
+        meter->subBlockEnergy += energy;
+        meter->subBlockFill += run;
+
+        true_peak_process(meter, frames, run);
+
+        if (meter->subBlockFill == meter->subBlockLength) {
+            finish_sub_block(meter);
+        }
+
+        frames += run * LOUDNESS_CHANNELS;
+        frameCount -= run;
+    }
+}
+
+void set_loudness_meter(LoudnessMeter *meter) {
+    loudnessMeterPtr = meter;
+}
+
+/**
+ * @brief Audio stream processor that meters the frames it is handed.
+ *
+ * @param bufferData Pointer to the buffer containing audio frames.
+ * @param frames The number of frames in the buffer.
+ *
+ * Attached next to callback() so that it sees exactly the samples that are
+ * sent to the device. It only reads the buffer.
+ */
+void loudness_callback(void *bufferData, unsigned int frames) {
+    if (loudnessMeterPtr == NULL) return;
+
+    PROFILE_BEGIN(PROFILE_AUDIO_LOUDNESS);
+    if (loudnessMeterPtr->resetRequested) {
+        loudness_reset(loudnessMeterPtr);
+    }
+    loudness_process(loudnessMeterPtr, (const float *)bufferData, frames);
+    PROFILE_END(PROFILE_AUDIO_LOUDNESS);
+}
+
+void loudness_print(const LoudnessMeter *meter) {
+    printf("Loudness: M %.1f S %.1f I %.1f LUFS, TP %.1f dBTP (max %.1f)\n",
+           meter->momentary, meter->shortTerm, meter->integrated,
+           meter->truePeak, meter->maxTruePeak);
+}
@@ -4,36 +4,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
-#include <sys/stat.h>
 
 #include "../include/playback.h"
 #include "../include/fft.h"
 #include "../include/ui.h"
+#include "../include/loudness.h"
+#include "../include/profiler.h"
+#include "../include/latency.h"
+#include "../include/alloc_tracker.h"
+#include "../include/player.h"
+#include "../include/loader.h"
+#include "../include/track_cache.h"
+#include "../include/probe.h"
+#include "../include/library_index.h"
+#include "../include/library.h"
 
-#define MAX_SONGS 100
 #define ARRAY_LEN(xs) (sizeof(xs) / sizeof((xs)[0]))
 
-typedef struct Song {
-    char name[256];
-    char filePath[1024];
-    struct Song* next;
-} Song;
-
-typedef struct Album {
-    char name[256];
-    Song* songs;
-    struct Album* next;
-    int songCount;
-    bool expanded;
-} Album;
-
-typedef struct {
-    Album* albums;
-    int albumCount;
-} Library;
-
 AudioData audioData;
+LoudnessMeter loudnessMeter;
+LatencyMonitor latencyMonitor;
 
 int screenWidth = 1200;
 int screenHeight = 900;
@@ -46,57 +36,70 @@ Color ACCENT_RED = {142, 142, 147, 255};
 Color DARKER_RED = {88, 86, 214, 255};
 
 
-Library userLibrary = {NULL, 0};
-SongNode* currentSong = NULL;
-SongNode* head = NULL;
-SongNode* tail = NULL;
-SongQueue songQueue = {.front = -1, .rear = -1};
+Library userLibrary;
+static LibraryIndexMapping mediaIndex = { 0 }; // Library strings point into it
+PlayQueue playQueue = { .current = PLAY_QUEUE_NONE };
 bool isPlaying = false;
 VisualizerType currentVisualizer = VISUALIZER_BAR_CHART;
 
 // Function declarations
 void LoadMediaLibrary();
-void processAlbumDirectory(const char* baseDir, const char* albumName);
-bool IsDirectory(const char* path);
 bool IsFileExtension(const char* filename, const char* ext);
-void AddAlbumToLibrary(const char* albumName);
 void AddSongToAlbum(const char* albumName, const char* songName, const char* filePath);
-SongNode* createSongNode(Music song, const char* title, const char* fullPath);
-void enqueueSong(Music song, const char* title, const char* fullPath);
-void playSongNode(SongNode* node);
-bool enqueueTitle(const char* title);
 void PlayPause();
 void SkipForward();
 void SkipBackward();
-void PlaySong(Song* song);
+void PlaySong(const LibrarySong* song);
 
 int main(void) {
+    ALLOC_TRACKER_NAME_THREAD("render");
+
     InitWindow(screenWidth, screenHeight, "Bragi Beats");
     SetTargetFPS(60);
 
     InitAudioDevice();
 
-    init_audio_data(&audioData); // Initialize AudioData
+    init_audio_data(&audioData, (float)player_output_rate()); // Analysed at the stream's rate
     set_audio_data(&audioData);  // Set AudioData for the callback
 
+    // Both taps see the output stream, which runs at the device's rate
+    loudness_init(&loudnessMeter, player_output_rate());
+    set_loudness_meter(&loudnessMeter);
+    double lastLoudnessLog = 0.0;
+
+    latency_init(&latencyMonitor, player_output_rate(), FFT_SIZE);
+    set_latency_monitor(&latencyMonitor);
+
+    // Every song plays through one output stream, tapped by both processors
+    AudioCallback processors[] = { callback, loudness_callback, NULL };
+    player_init(processors);
+    loader_init();
+    probe_init();
+
     InitUI();
 
     // Load media library
     LoadMediaLibrary();
 
     while (!WindowShouldClose()) {
+        PROFILE_BEGIN(PROFILE_FRAME);
+
         // Check for dropped files
+        PROFILE_BEGIN(PROFILE_FILE_DROP);
         if (IsFileDropped()) {
+            ALLOC_TRACKER_ALLOW_FRAME();
             FilePathList droppedFiles = LoadDroppedFiles();  // Get the list of dropped files
             for (unsigned int i = 0; i < droppedFiles.count; i++) {
                 // Check if the file is a valid audio file
                 if (IsFileExtension(droppedFiles.paths[i], ".wav") || IsFileExtension(droppedFiles.paths[i], ".mp3")) {
-                    // Load the dropped file as a new song and add to the queue
-                    Music song = LoadMusicStream(droppedFiles.paths[i]);
-                    if (song.stream.buffer != NULL) {
-                        enqueueSong(song, GetFileName(droppedFiles.paths[i]), droppedFiles.paths[i]);
-                    } else {
-                        printf("Failed to load dropped file: %s\n", droppedFiles.paths[i]);
+                    // Queued right away as loading; a probe worker checks the
+                    // file, and it is decoded in the background when its turn comes
+                    size_t id = enqueueSong(GetFileName(droppedFiles.paths[i]), droppedFiles.paths[i]);
+                    if (id != PLAY_QUEUE_NONE) {
+                        play_queue_entry(&playQueue, id)->status = SONG_PROBING;
+                        if (!probe_submit(droppedFiles.paths[i], (void*)(uintptr_t)id)) {
+                            play_queue_entry(&playQueue, id)->status = SONG_PLAYABLE; // Left to the decoder to reject
+                        }
                     }
                 } else {
                     printf("Dropped file is not a supported audio file: %s\n", droppedFiles.paths[i]);
@@ -105,65 +108,95 @@ int main(void) {
             UnloadDroppedFiles(droppedFiles); // Free the dropped files buffer
         }
 
+        ProbeResult probe;
+        while (probe_collect(&probe)) {
+            QueueEntry* entry = play_queue_entry(&playQueue, (size_t)(uintptr_t)probe.tag);
+            if (entry->status == SONG_PROBING) {
+                entry->status = probe.playable ? SONG_PLAYABLE : SONG_FAILED;
+            }
+            if (!probe.playable) {
+                printf("Failed to load dropped file: %s\n", play_queue_path(&playQueue, entry));
+            }
+        }
+        PROFILE_END(PROFILE_FILE_DROP);
+
         // Handle input and update playback state
+        PROFILE_BEGIN(PROFILE_INPUT);
         HandleInput();
+        PROFILE_END(PROFILE_INPUT);
+
+        PROFILE_BEGIN(PROFILE_PLAYBACK);
         UpdatePlaybackState();
+        PROFILE_END(PROFILE_PLAYBACK);
 
         // Process audio data
+        PROFILE_BEGIN(PROFILE_ANALYSIS);
+        HandleAnalysisInput();
         size_t numberOfFftBins = ProcessFFT(&audioData);
+        PROFILE_END(PROFILE_ANALYSIS);
+
+        // Log loudness once per second while playing
+        if (isPlaying && GetTime() - lastLoudnessLog >= 1.0) {
+            loudness_print(&loudnessMeter);
+            lastLoudnessLog = GetTime();
+        }
 
         // Render UI
         RenderUI(numberOfFftBins, &audioData);
+
+        PROFILE_END(PROFILE_FRAME);
+        PROFILE_FRAME_END();
+        ALLOC_TRACKER_FRAME_END();
     }
 
+#ifdef ENABLE_ALLOC_TRACKER
+    alloc_tracker_print_summary();
+#endif
+
     // Clean up
+    StopCurrentSong();
+    probe_shutdown();
+    loader_shutdown();
+    player_shutdown();
+    track_cache_clear();
+    play_queue_free(&playQueue);
+    library_free(&userLibrary);
+    library_index_unmap(&mediaIndex);
     CloseAudioDevice();
     CloseWindow();
 
     return 0;
 }
 
-void LoadMediaLibrary() {
-    const char* mediaPath = "./media";
-    processAlbumDirectory(mediaPath, NULL);
+// Songs are filed under the directory that holds them; loose files in the
+// media root go to "Miscellaneous"
+static void AddScannedSong(void* context, const LibraryScanSong* song) {
+    (void)context;
+    AddSongToAlbum(song->album ? song->album : "Miscellaneous", song->name, song->path);
 }
 
-void processAlbumDirectory(const char* baseDir, const char* albumName) {
-    DIR* dir;
-    struct dirent* entry;
-    char pathBuffer[1024];
-
-    if ((dir = opendir(baseDir)) == NULL) {
-        perror("Failed to open media directory");
-        return;
-    }
-
-    while ((entry = readdir(dir)) != NULL) {
-        // Ignore "." and ".."
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            continue;
+// Songs from the index point into its mapping; the library keeps those
+// pointers instead of copying the strings
+static void BorrowIndexStrings(void* context, const char* block, size_t size) {
+    (void)context;
+    library_borrow(&userLibrary, block, size);
+}
 
-        sprintf(pathBuffer, "%s/%s", baseDir, entry->d_name);
+void LoadMediaLibrary() {
+    const char* mediaPath = "./media";
 
-        if (IsDirectory(pathBuffer)) {
-            // Recurse into subdirectories
-            processAlbumDirectory(pathBuffer, entry->d_name);
-        } else if (IsFileExtension(entry->d_name, ".wav") || IsFileExtension(entry->d_name, ".mp3")) {
-            // Add song to album
-            const char* album = albumName ? albumName : "Miscellaneous";
-            AddSongToAlbum(album, entry->d_name, pathBuffer);
-        }
+    LibraryScanVisitor visitor = { AddScannedSong, NULL, NULL, BorrowIndexStrings, NULL, NULL };
+    LibraryIndexStats stats;
+    if (!library_index_load(LIBRARY_INDEX_PATH, mediaPath, &visitor, &stats, &mediaIndex)) {
+        return;
     }
-
-    closedir(dir);
-}
-
-bool IsDirectory(const char* path) {
-    struct stat statbuf;
-    if (stat(path, &statbuf) != 0) {
-        return false;
+    printf("Loaded %s: %llu songs in %llu directories, %llu listed%s, in %.3f s\n",
+           mediaPath, (unsigned long long)stats.songs, (unsigned long long)stats.directories,
+           (unsigned long long)stats.rescanned, stats.rebuilt ? " (index rebuilt)" : "", stats.seconds);
+    if (stats.scan.files > 0) {
+        printf("Scanned %llu files at %.0f files/s\n", (unsigned long long)stats.scan.files,
+               stats.scan.seconds > 0.0 ? (double)stats.scan.files / stats.scan.seconds : 0.0);
     }
-    return S_ISDIR(statbuf.st_mode);
 }
 
 bool IsFileExtension(const char* filename, const char* ext) {
@@ -172,214 +205,191 @@ bool IsFileExtension(const char* filename, const char* ext) {
     return strcmp(dot, ext) == 0;
 }
 
-void AddAlbumToLibrary(const char* albumName) {
-    if (!albumName) {
-        fprintf(stderr, "Invalid album name provided.\n");
-        return;
-    }
-
-    Album* newAlbum = (Album*)malloc(sizeof(Album));
-    if (!newAlbum) {
-        fprintf(stderr, "Failed to allocate memory for new album.\n");
-        return;
-    }
-    strncpy(newAlbum->name, albumName, sizeof(newAlbum->name) - 1);
-    newAlbum->name[sizeof(newAlbum->name) - 1] = '\0';
-    newAlbum->songs = NULL;
-    newAlbum->next = userLibrary.albums;
-    newAlbum->songCount = 0;
-    newAlbum->expanded = false;
-    userLibrary.albums = newAlbum;
-    userLibrary.albumCount++;
-}
-
 void AddSongToAlbum(const char* albumName, const char* songName, const char* filePath) {
     if (!albumName || !songName || !filePath) {
         fprintf(stderr, "Invalid album or song name provided.\n");
         return;
     }
 
-    Album* currentAlbum = userLibrary.albums;
-
-    // Search for existing album
-    while (currentAlbum != NULL && strcmp(currentAlbum->name, albumName) != 0) {
-        currentAlbum = currentAlbum->next;
+    if (!library_add_song(&userLibrary, albumName, songName, filePath)) {
+        fprintf(stderr, "Failed to add %s to the library.\n", filePath);
     }
+}
 
-    // If no existing album found, create a new one
-    if (currentAlbum == NULL) {
-        AddAlbumToLibrary(albumName);
-        currentAlbum = userLibrary.albums; // since we add to the front
-    }
+QueueEntry* currentEntry(void) {
+    return play_queue_at(&playQueue, playQueue.current);
+}
 
-    // Create new song
-    Song* newSong = (Song*)malloc(sizeof(Song));
-    if (!newSong) {
-        fprintf(stderr, "Failed to allocate memory for new song.\n");
-        return;
+QueueEntry* nextEntry(void) {
+    if (playQueue.current == PLAY_QUEUE_NONE) {
+        return NULL;
     }
-    strncpy(newSong->name, songName, sizeof(newSong->name) -1);
-    newSong->name[sizeof(newSong->name) - 1] = '\0';
-    strncpy(newSong->filePath, filePath, sizeof(newSong->filePath) - 1);
-    newSong->filePath[sizeof(newSong->filePath) - 1] = '\0';
-    newSong->next = currentAlbum->songs;
-    currentAlbum->songs = newSong;
-    currentAlbum->songCount++;
+    return play_queue_at(&playQueue, playQueue.current + 1);
 }
 
-SongNode* createSongNode(Music song, const char* title, const char* fullPath) {
-    SongNode* newNode = (SongNode*)malloc(sizeof(SongNode));
-    if (newNode == NULL) {
-        fprintf(stderr, "Memory allocation failed\n");
-        return NULL;
+size_t enqueueSong(const char* title, const char* fullPath) {
+    size_t id = play_queue_append(&playQueue, title, fullPath);
+    if (id == PLAY_QUEUE_NONE) {
+        return PLAY_QUEUE_NONE;
     }
 
-    newNode->song = song;
-    strncpy(newNode->title, title, sizeof(newNode->title) -1);
-    newNode->title[sizeof(newNode->title) -1] = '\0';
-    strncpy(newNode->fullPath, fullPath, sizeof(newNode->fullPath) -1);
-    newNode->fullPath[sizeof(newNode->fullPath) -1] = '\0';
-    newNode->next = NULL;
-    newNode->prev = tail;
-    return newNode;
+    if (!isPlaying) {
+        playQueuePosition(playQueue.count - 1);
+    }
+    return id;
 }
 
-void enqueueSong(Music song, const char* title, const char* fullPath) {
-    SongNode* newNode = createSongNode(song, title, fullPath);
-    if (tail != NULL) {
-        tail->next = newNode;
-    } else {
-        head = newNode;
+static void releaseTrack(QueueEntry* entry) {
+    if (entry != NULL && entry->track != NULL) {
+        player_release(entry->track);
+        entry->track = NULL;
     }
-    tail = newNode;
+}
 
-    if (!isPlaying) {
-        playSongNode(newNode);
+// Hand back the decoded tracks of the entries around a previous play
+// position that are no longer the current song or its successor
+static void releaseStaleTracks(size_t previous) {
+    if (previous == PLAY_QUEUE_NONE) {
+        return;
     }
 
-    if (!enqueueTitle(title)) {
-        printf("Queue Full\n");
+    QueueEntry* current = currentEntry();
+    QueueEntry* next = nextEntry();
+    QueueEntry* held[2] = { play_queue_at(&playQueue, previous), play_queue_at(&playQueue, previous + 1) };
+
+    for (int i = 0; i < 2; i++) {
+        if (held[i] != current && held[i] != next) {
+            releaseTrack(held[i]);
+        }
     }
 }
 
-void playSongNode(SongNode* node) {
-    currentSong = node;
-    PlayMusicStream(node->song);
-    SetMusicVolume(node->song, 0.5f);
-    AttachAudioStreamProcessor(node->song.stream, callback);
+void playQueuePosition(size_t position) {
+    if (position >= playQueue.count) {
+        return;
+    }
+
+    size_t previous = playQueue.current;
+    playQueue.current = position;
     isPlaying = true;
+    loudness_request_reset(&loudnessMeter);
+
+    // Starts the song now if it is decoded, or once the loader is done
+    PlayCurrentSong();
+    releaseStaleTracks(previous);
 }
 
-bool enqueueTitle(const char* title) {
-    if (songQueue.rear == MAX_SONGS - 1) {
-        return false;
+// Called once per S press, from HandleInput
+void ShuffleQueue(void) {
+    // A press counter keeps presses within one clock tick apart
+    static uint64_t presses = 0;
+    presses++;
+    if (!play_queue_shuffle(&playQueue, (uint64_t)(GetTime() * 1e6) ^ (presses << 32) ^ playQueue.count)) {
+        return;
     }
 
-    if (songQueue.front == -1) {
-        songQueue.front = 0;
+    // Anything decoded ahead may no longer be next; a sweep is cheap next
+    // to the shuffle itself
+    QueueEntry* current = currentEntry();
+    QueueEntry* next = nextEntry();
+    for (size_t position = 0; position < playQueue.count; position++) {
+        QueueEntry* entry = play_queue_at(&playQueue, position);
+        if (entry != current && entry != next) {
+            releaseTrack(entry);
+        }
     }
-    songQueue.rear++;
-    strncpy(songQueue.titles[songQueue.rear], title, sizeof(songQueue.titles[songQueue.rear]) -1);
-    songQueue.titles[songQueue.rear][sizeof(songQueue.titles[songQueue.rear]) -1] = '\0';
-    return true;
+    player_set_next(next != NULL ? next->track : NULL);
 }
 
 void PlayPause() {
-    if (currentSong != NULL) {
+    if (currentEntry() != NULL) {
         isPlaying = !isPlaying;
-        if (isPlaying) {
-            PlayMusicStream(currentSong->song);
+        if (isPlaying && player_playing_track() == NULL) {
+            // Stopped at the end of the queue: start over
+            PlayCurrentSong();
         } else {
-            PauseMusicStream(currentSong->song);
+            player_set_paused(!isPlaying);
         }
     }
 }
 
 void SkipForward() {
-    if (currentSong && currentSong->next) {
-        UnloadMusicStream(currentSong->song);
-        currentSong = currentSong->next;
-        currentSong->song = LoadMusicStream(currentSong->fullPath);
-
-        if (currentSong->song.stream.buffer != NULL) {
-            PlayMusicStream(currentSong->song);
-            SetMusicVolume(currentSong->song, 0.5f);
-            AttachAudioStreamProcessor(currentSong->song.stream, callback);
-        } else {
-            printf("Error: Failed to load song stream for: %s\n", currentSong->title);
-        }
+    if (nextEntry() != NULL) {
+        playQueuePosition(playQueue.current + 1);
     } else {
         printf("Cannot skip forward: No next song.\n");
     }
 }
 
 void SkipBackward() {
-    if (currentSong && currentSong->prev) {
-        UnloadMusicStream(currentSong->song);
-
-        currentSong = currentSong->prev;
-        currentSong->song = LoadMusicStream(currentSong->fullPath);
-        if (currentSong->song.stream.buffer != NULL) {
-            PlayMusicStream(currentSong->song);
-            SetMusicVolume(currentSong->song, 0.5f);
-            AttachAudioStreamProcessor(currentSong->song.stream, callback);
-        } else {
-            printf("Error: Failed to load the previous song stream.\n");
-        }
+    if (currentEntry() != NULL && playQueue.current > 0) {
+        playQueuePosition(playQueue.current - 1);
     } else {
         printf("No previous song to play.\n");
         isPlaying = false;
+        player_set_paused(true);
     }
 }
 
-void PlaySong(Song* song) {
+void PlaySong(const LibrarySong* song) {
     if (song == NULL) {
         fprintf(stderr, "Invalid song.\n");
         return;
     }
 
-    if (isPlaying && currentSong != NULL) {
-        StopMusicStream(currentSong->song);
-        UnloadMusicStream(currentSong->song);
-    }
-
-    Music newSong = LoadMusicStream(song->filePath);
-    if (newSong.ctxData != NULL) {
-        if (currentSong != NULL) {
-            free(currentSong);
-        }
-
-        currentSong = (SongNode*)malloc(sizeof(SongNode));
-        if (currentSong == NULL) {
-            fprintf(stderr, "Failed to allocate memory for the new song node.\n");
-            return;
-        }
+    ALLOC_TRACKER_ALLOW_FRAME();
 
-        strncpy(currentSong->title, song->name, sizeof(currentSong->title) -1);
-        currentSong->title[sizeof(currentSong->title) -1] = '\0';
-        strncpy(currentSong->fullPath, song->filePath, sizeof(currentSong->fullPath) -1);
-        currentSong->fullPath[sizeof(currentSong->fullPath) -1] = '\0';
-        currentSong->song = newSong;
+    // Library picks join the end of the queue and play straight away
+    size_t id = play_queue_append(&playQueue, library_string(&userLibrary, song->name),
+                                  library_string(&userLibrary, song->path));
+    if (id == PLAY_QUEUE_NONE) {
+        return;
+    }
+    playQueuePosition(playQueue.count - 1);
+}
 
-        PlayMusicStream(newSong);
-        SetMusicVolume(newSong, 0.5f);
-        isPlaying = true;
-        AttachAudioStreamProcessor(newSong.stream, callback);
-    } else {
-        fprintf(stderr, "Failed to load song: %s\n", song->filePath);
+void attachTrack(QueueEntry* entry, PlayerTrack* track) {
+    entry->track = track;
+    if (track != NULL) {
+        entry->sampleRate = track->sourceRate;
+        entry->sampleBits = track->sourceBits;
     }
 }
 
 void StopCurrentSong(void) {
-    if (currentSong != NULL) {
-        StopMusicStream(currentSong->song);
-    }
+    player_play(NULL, 0);
     isPlaying = false;
+
+    // Nothing stays decoded while stopped; the track cache has the
+    // current song should playback resume
+    releaseTrack(currentEntry());
+    releaseTrack(nextEntry());
 }
 
 void PlayCurrentSong(void) {
-    if (currentSong != NULL) {
-        PlayMusicStream(currentSong->song);
-        isPlaying = true;
+    QueueEntry* current = currentEntry();
+    if (current == NULL) {
+        return;
+    }
+
+    isPlaying = true;
+    player_set_paused(false);
+
+    // Replays and back-skips usually find the track still decoded
+    const char* path = play_queue_path(&playQueue, current);
+    if (current->track == NULL) {
+        attachTrack(current, track_cache_take(path));
+    }
+
+    if (current->track != NULL) {
+        QueueEntry* next = nextEntry();
+        player_play(current->track, 0);
+        if (next != NULL && next->track != NULL) {
+            player_set_next(next->track);
+        }
+    } else {
+        // Silence until the decode finishes; UpdatePlaybackState starts it
+        player_play(NULL, 0);
+        loader_request(path, true);
     }
 }
@@ -0,0 +1,177 @@
+// loader.c
+//
+// Background decoding for playback. A single worker thread turns requested
+// paths into PlayerTracks so that neither the render loop nor the audio
+// thread ever waits on file I/O or a decoder. The slot table is shared with
+// the render loop under one mutex; it is never touched by the audio thread.
+// Tracks still in the track cache are handed out without decoding again.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/loader.h"
+#include "../../include/alloc_tracker.h"
+#include "../../include/track_cache.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_DECODING,
+    SLOT_DONE
+} SlotState;
+
+/**
+ * @brief One decode request and, once finished, its result.
+ */
+typedef struct {
+    SlotState state;
+    bool urgent;
+    uint64_t order;           /**< Request sequence number, for FIFO and eviction */
+    char path[1024];
+    PlayerTrack *track;       /**< Result; NULL on failure */
+} LoaderSlot;
+
+static LoaderSlot slots[LOADER_SLOTS];
+static uint64_t requestCount = 0;
+static bool running = false;
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+
+static LoaderSlot* find_slot(const char *path) {
+    for (int i = 0; i < LOADER_SLOTS; ++i) {
+        if (slots[i].state != SLOT_FREE && strcmp(slots[i].path, path) == 0) return &slots[i];
+    }
+    return NULL;
+}
+
+// Urgent requests first, then oldest first
+static LoaderSlot* next_queued(void) {
+    LoaderSlot *best = NULL;
+    for (int i = 0; i < LOADER_SLOTS; ++i) {
+        LoaderSlot *slot = &slots[i];
+        if (slot->state != SLOT_QUEUED) continue;
+        if (best == NULL || (slot->urgent && !best->urgent) ||
+            (slot->urgent == best->urgent && slot->order < best->order)) {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+static void* loader_thread(void *arg) {
+    (void)arg;
+    ALLOC_TRACKER_NAME_WORKER("loader");
+
+    pthread_mutex_lock(&lock);
+    while (running) {
+        LoaderSlot *slot = next_queued();
+        if (slot == NULL) {
+            pthread_cond_wait(&wake, &lock);
+            continue;
+        }
+
+        // A decoding slot is never evicted, so it can be filled in unlocked
+        char path[sizeof(slot->path)];
+        memcpy(path, slot->path, sizeof(path));
+        slot->state = SLOT_DECODING;
+        pthread_mutex_unlock(&lock);
+
+        PlayerTrack *track = track_cache_take(path);
+        if (track == NULL) track = player_load_track(path);
+
+        pthread_mutex_lock(&lock);
+        slot->track = track;
+        slot->state = SLOT_DONE;
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+void loader_init(void) {
+    running = true;
+    if (pthread_create(&thread, NULL, loader_thread, NULL) != 0) {
+        fprintf(stderr, "Failed to start the loader thread\n");
+        running = false;
+    }
+}
+
+void loader_shutdown(void) {
+    if (!running) return;
+
+    pthread_mutex_lock(&lock);
+    running = false;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+
+    for (int i = 0; i < LOADER_SLOTS; ++i) {
+        if (slots[i].state == SLOT_DONE) player_unload_track(slots[i].track);
+        slots[i].state = SLOT_FREE;
+    }
+}
+
+bool loader_request(const char *path, bool urgent) {
+    if (!running) return false;
+
+    pthread_mutex_lock(&lock);
+
+    LoaderSlot *slot = find_slot(path);
+    if (slot != NULL) {
+        slot->urgent = slot->urgent || urgent;
+        pthread_mutex_unlock(&lock);
+        return true;
+    }
+
+    // A free slot, else the oldest result nobody collected
+    for (int i = 0; i < LOADER_SLOTS; ++i) {
+        if (slots[i].state == SLOT_FREE) {
+            slot = &slots[i];
+            break;
+        }
+        if (slots[i].state == SLOT_DONE && (slot == NULL || slots[i].order < slot->order)) {
+            slot = &slots[i];
+        }
+    }
+    if (slot == NULL) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    if (slot->state == SLOT_DONE) {
+        // Never handed to the player, so it can be cached directly
+        ALLOC_TRACKER_ALLOW_FRAME();
+        track_cache_put(slot->track);
+    }
+
+    slot->state = SLOT_QUEUED;
+    slot->urgent = urgent;
+    slot->order = requestCount++;
+    slot->track = NULL;
+    strncpy(slot->path, path, sizeof(slot->path) - 1);
+    slot->path[sizeof(slot->path) - 1] = '\0';
+
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+LoaderStatus loader_poll(const char *path, PlayerTrack **track) {
+    LoaderStatus status = LOADER_IDLE;
+
+    pthread_mutex_lock(&lock);
+    LoaderSlot *slot = find_slot(path);
+    if (slot != NULL) {
+        if (slot->state == SLOT_DONE) {
+            *track = slot->track;
+            status = slot->track != NULL ? LOADER_READY : LOADER_FAILED;
+            slot->state = SLOT_FREE;
+        } else {
+            status = LOADER_PENDING;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return status;
+}
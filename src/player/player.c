@@ -0,0 +1,1016 @@
+// player.c
+//
+// Output stage of playback. One raylib audio stream replaces a Music stream
+// per song, and is fed in two steps:
+//
+//   decode thread   player_decode: applies play requests, converts frames of
+//                   the current track (straight from the file mapping of a
+//                   WAV, from a streaming decoder, or from PCM decoded in
+//                   full; resampled on the way if the file is at another
+//                   rate), and chains into the queued successor
+//                   when it ends, or crossfades into it over its last
+//                   seconds, writing into a float PCM ring that runs up
+//                   to PLAYER_RING_FRAMES ahead of the device
+//   audio thread    player_mix: copies frames out of the ring and publishes
+//                   which track and frame the device has reached
+//
+// Neither step depends on the render loop, so a slow frame cannot starve the
+// device, and track changes land on the sample.
+//
+// No locks are shared. Play requests and the queued successor are published
+// through atomic pointers; the ring, and a queue of markers recording where
+// in the ring each track segment starts, are single-producer
+// single-consumer. Tracks leave the player only through the render loop,
+// once neither thread can reach them (player_reclaim); they then go to the
+// track cache for a replay.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/player.h"
+#include "../../include/fft.h"
+#include "../../include/alloc_tracker.h"
+#include "../../include/track_cache.h"
+#include "../../include/simd.h"
+#include "../../include/resample.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Vendored decoders, compiled into this file only. raylib builds its own
+// copies into its audio module with external linkage, so these stay
+// internal to avoid clashing with them; the ones left unused are expected.
+#define DRMP3_API static
+#define DRMP3_PRIVATE static
+#define DRWAV_API static
+#define DRWAV_PRIVATE static
+#define DR_MP3_IMPLEMENTATION
+#define DR_WAV_IMPLEMENTATION
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "dr_mp3.h"
+#include "dr_wav.h"
+#pragma GCC diagnostic pop
+
+/**
+ * @brief A play request: the track to switch to and where to start.
+ */
+typedef struct {
+    PlayerTrack *track;
+    uint64_t frame;
+    uint32_t serial;
+} PlayerRequest;
+
+/**
+ * @brief Start of a track segment in the ring.
+ */
+typedef struct {
+    uint64_t position;        /**< Ring frame the segment starts at */
+    PlayerTrack *track;       /**< NULL once playback has stopped */
+    uint64_t frame;           /**< Track frame at position */
+    uint32_t serial;          /**< Request the segment belongs to */
+    bool ended;               /**< The previous track ran out with no successor */
+} RingMarker;
+
+/**
+ * @brief A released track waiting for both threads to drop it.
+ */
+typedef struct {
+    PlayerTrack *track;
+    uint64_t decodes;         /**< Decode passes completed at release */
+    bool drained;             /**< No longer reachable by the decode thread */
+    uint64_t drainPosition;   /**< Ring position the device must pass */
+} RetiredTrack;
+
+/**
+ * @brief Streaming decoder owned by a track.
+ */
+typedef enum {
+    DECODER_NONE,
+    DECODER_MP3,
+    DECODER_WAV
+} DecoderType;
+
+/**
+ * @brief Incremental decode state of a track that is not read in place.
+ * Used by the loader while it prefetches the head, then only by the
+ * decode thread.
+ */
+struct PlayerStream {
+    DecoderType decoder;      /**< Which of mp3 and wav is open */
+    drmp3 mp3;
+    drwav wav;
+    drmp3_seek_point *seekPoints; /**< Bound to mp3, so seeks start near their target */
+    drmp3_uint32 seekPointCount;
+    uint64_t sourceFrames;    /**< Length of the source, at its own rate */
+    unsigned int channels;    /**< Channels the decoder returns */
+    uint64_t cursor;          /**< Next frame the decoder returns */
+    uint64_t advised;         /**< Mapping is paged in ahead up to here */
+    float *scratch;           /**< One decoder read, in the file's channels */
+
+    bool resampling;
+    Resampler resampler;
+    float *window;            /**< Interleaved stereo source frames of the current block */
+    int64_t windowStart;      /**< Source frame in window[0]; negative before the start */
+    size_t windowFrames;
+    float *planar;
+    float *converted;
+    float *block;             /**< Last block converted, interleaved stereo */
+    uint64_t blockStart;
+    size_t blockFrames;
+
+    float *head;              /**< First output frames, prefetched by the loader */
+    uint64_t headFrames;
+    size_t bytes;             /**< Heap held by the stream, itself included */
+};
+
+static AudioStream output = { 0 };
+static const unsigned int outputRate = PLAYER_OUTPUT_RATE;
+static pthread_t decodeThread;
+static bool decodeRunning = false;
+
+// Any thread → loader
+static int resampleQuality = PLAYER_RESAMPLE_QUALITY;
+
+// Render loop → decode thread
+static PlayerRequest requests[PLAYER_REQUESTS];
+static unsigned int requestHead = 0;
+static uint32_t requestSerial = 0;
+static PlayerRequest *pendingRequest = NULL;
+static PlayerTrack *nextTrack = NULL;
+static uint64_t crossfadeFrames = 0;
+
+// Decode thread → audio thread
+static float ring[PLAYER_RING_FRAMES * PLAYER_CHANNELS];
+static uint64_t ringWrite = 0;      /**< Frames ever written; published with release */
+static uint64_t ringFlush = 0;      /**< Frames before this are stale */
+static uint64_t ringRead = 0;       /**< Frames ever consumed; published with release */
+static RingMarker markers[PLAYER_MARKERS];
+static uint64_t markerWrite = 0;
+static uint64_t markerRead = 0;
+
+// Decode thread only
+static PlayerTrack *decodeTrack = NULL;
+static uint64_t decodeFrame = 0;
+static uint32_t decodeSerial = 0;
+static bool decodeEnded = false;
+static uint64_t decodeAdvised = 0;    /**< Read-ahead is renewed past this frame */
+static PlayerTrack *fadeTrack = NULL; /**< Track fading out under decodeTrack */
+static uint64_t fadeFrame = 0;        /**< Next frame of fadeTrack */
+static uint64_t fadePosition = 0;     /**< Frames of the fade written */
+static uint64_t fadeLength = 0;
+static float fadeBuffer[PLAYER_RING_FRAMES * PLAYER_CHANNELS];
+
+// Decode thread → render loop
+static PlayerTrack *decodingTrack = NULL;
+static PlayerTrack *fadingTrack = NULL;
+static uint64_t decodeCount = 0;
+
+// Audio thread only
+static RingMarker segment = { 0 };
+
+// Audio thread → render loop
+static PlayerTrack *playingTrack = NULL;
+static uint64_t playingFrame = 0;
+static bool trackEnded = false;
+static uint32_t appliedSerial = 0;
+static uint64_t underrunCount = 0;
+
+// Render loop only
+static RetiredTrack retired[PLAYER_RETIRED_TRACKS];
+static uint64_t scrubFrame = UINT64_MAX; /**< Target of the last scrub request */
+static size_t retiredCount = 0;
+
+static void set_source(PlayerTrack *track, const char *path, const struct stat *st) {
+    track->modified = (int64_t)st->st_mtime;
+    track->fileSize = (uint64_t)st->st_size;
+    strncpy(track->path, path, sizeof(track->path) - 1);
+    track->path[sizeof(track->path) - 1] = '\0';
+}
+
+static size_t decoder_read(PlayerStream *stream, float *out, size_t frames) {
+    if (stream->decoder == DECODER_MP3) {
+        return (size_t)drmp3_read_pcm_frames_f32(&stream->mp3, frames, out);
+    }
+    return (size_t)drwav_read_pcm_frames_f32(&stream->wav, frames, out);
+}
+
+static bool decoder_seek(PlayerStream *stream, uint64_t frame) {
+    if (stream->decoder == DECODER_MP3) {
+        return drmp3_seek_to_pcm_frame(&stream->mp3, frame) != 0;
+    }
+    return drwav_seek_to_pcm_frame(&stream->wav, frame) != 0;
+}
+
+// Interleaved stereo source frames inside the file; a decoder that comes up
+// short leaves silence
+static void read_source(const PlayerTrack *track, uint64_t frame, float *out, size_t frames) {
+    PlayerStream *stream = track->stream;
+
+    if (track->mapped) {
+        // Page in the stretch after this one, again after a jump back
+        if (frame + frames > stream->advised || frame + WAV_MAP_READAHEAD_FRAMES < stream->advised) {
+            wav_map_advise(&track->map, frame, WAV_MAP_READAHEAD_FRAMES);
+            stream->advised = frame + WAV_MAP_READAHEAD_FRAMES / 2;
+        }
+        wav_map_read_float(&track->map, frame, out, frames, PLAYER_CHANNELS);
+        return;
+    }
+
+    if (track->frames != NULL) {
+        const int16_t *in = track->frames + frame * PLAYER_CHANNELS;
+        for (size_t i = 0; i < frames * PLAYER_CHANNELS; ++i) {
+            out[i] = (float)in[i] * (1.0f / 32768.0f);
+        }
+        return;
+    }
+
+    // Decoders only run forward cheaply; reads are sequential except after a seek
+    size_t done = 0;
+    if (frame == stream->cursor || decoder_seek(stream, frame)) {
+        stream->cursor = frame;
+        while (done < frames) {
+            size_t chunk = frames - done < PLAYER_DECODE_CHUNK ? frames - done : PLAYER_DECODE_CHUNK;
+            size_t got = decoder_read(stream, stream->scratch, chunk);
+
+            // Mono is duplicated; past two channels only the front pair plays
+            float *dst = out + done * PLAYER_CHANNELS;
+            for (size_t i = 0; i < got; ++i) {
+                const float *src = stream->scratch + i * stream->channels;
+                dst[i * PLAYER_CHANNELS] = src[0];
+                dst[i * PLAYER_CHANNELS + 1] = stream->channels > 1 ? src[1] : src[0];
+            }
+            done += got;
+            stream->cursor += got;
+            if (got < chunk) break;
+        }
+    } else {
+        stream->cursor = UINT64_MAX;
+    }
+    memset(out + done * PLAYER_CHANNELS, 0, (frames - done) * PLAYER_CHANNELS * sizeof(float));
+}
+
+// Source frames [from, to), silent outside the file
+static void fill_window(const PlayerTrack *track, int64_t from, int64_t to, float *out) {
+    int64_t inside = (int64_t)track->stream->sourceFrames;
+    int64_t first = from > 0 ? from : 0;
+    int64_t last = to < inside ? to : inside;
+
+    memset(out, 0, (size_t)(to - from) * PLAYER_CHANNELS * sizeof(float));
+    if (first < last) {
+        read_source(track, (uint64_t)first, out + (size_t)(first - from) * PLAYER_CHANNELS, (size_t)(last - first));
+    }
+}
+
+// Converts the RESAMPLE_BLOCK output frames from `first` into the block buffer
+static void convert_block(const PlayerTrack *track, uint64_t first) {
+    PlayerStream *stream = track->stream;
+    const Resampler *resampler = &stream->resampler;
+    size_t count = track->frameCount - first < RESAMPLE_BLOCK ? (size_t)(track->frameCount - first) : RESAMPLE_BLOCK;
+    int64_t start = resampler_first_input(resampler, first);
+    int64_t end = resampler_first_input(resampler, first + count - 1) + resampler->taps;
+
+    // Consecutive blocks overlap by the filter length; keep the frames the
+    // last one read, so the source is only ever read forward
+    int64_t windowEnd = stream->windowStart + (int64_t)stream->windowFrames;
+    int64_t kept = 0;
+    if (start >= stream->windowStart && start < windowEnd) {
+        kept = (windowEnd < end ? windowEnd : end) - start;
+        memmove(stream->window, stream->window + (size_t)(start - stream->windowStart) * PLAYER_CHANNELS,
+                (size_t)kept * PLAYER_CHANNELS * sizeof(float));
+    }
+    fill_window(track, start + kept, end, stream->window + (size_t)kept * PLAYER_CHANNELS);
+    stream->windowStart = start;
+    stream->windowFrames = (size_t)(end - start);
+
+    for (int c = 0; c < PLAYER_CHANNELS; ++c) {
+        for (size_t i = 0; i < stream->windowFrames; ++i) {
+            stream->planar[i] = stream->window[i * PLAYER_CHANNELS + c];
+        }
+        resampler_process(resampler, stream->planar, start, first, stream->converted, count);
+        for (size_t i = 0; i < count; ++i) {
+            stream->block[i * PLAYER_CHANNELS + c] = stream->converted[i];
+        }
+    }
+    stream->blockStart = first;
+    stream->blockFrames = count;
+}
+
+static void read_stream(const PlayerTrack *track, uint64_t frame, float *out, uint64_t frames) {
+    PlayerStream *stream = track->stream;
+    if (!stream->resampling) {
+        read_source(track, frame, out, (size_t)frames);
+        return;
+    }
+
+    while (frames > 0) {
+        if (frame < stream->blockStart || frame >= stream->blockStart + stream->blockFrames) {
+            convert_block(track, frame - frame % RESAMPLE_BLOCK);
+        }
+        uint64_t offset = frame - stream->blockStart;
+        uint64_t count = stream->blockFrames - offset < frames ? stream->blockFrames - offset : frames;
+        memcpy(out, stream->block + offset * PLAYER_CHANNELS, (size_t)count * PLAYER_CHANNELS * sizeof(float));
+        out += count * PLAYER_CHANNELS;
+        frame += count;
+        frames -= count;
+    }
+}
+
+static float* stream_alloc(PlayerStream *stream, size_t floats) {
+    stream->bytes += floats * sizeof(float);
+    return (float *)malloc(floats * sizeof(float));
+}
+
+static void close_stream(PlayerStream *stream) {
+    if (stream == NULL) return;
+    if (stream->decoder == DECODER_MP3) drmp3_uninit(&stream->mp3);
+    if (stream->decoder == DECODER_WAV) drwav_uninit(&stream->wav);
+    free(stream->seekPoints);
+    if (stream->resampling) resampler_free(&stream->resampler);
+    free(stream->scratch);
+    free(stream->window);
+    free(stream->planar);
+    free(stream->converted);
+    free(stream->block);
+    free(stream->head);
+    free(stream);
+}
+
+// An MP3 can only be decoded forward, so without a table every backward
+// seek or scrub decodes again from the first frame. One point per second
+// of audio bounds a seek to about a second of decoding; the scan that
+// places them reads the whole file, once, here on the loader thread.
+static void bind_seek_table(PlayerStream *stream) {
+    drmp3_uint32 count = (drmp3_uint32)(stream->sourceFrames / stream->mp3.sampleRate) + 1;
+    stream->seekPoints = (drmp3_seek_point *)malloc(count * sizeof(drmp3_seek_point));
+    if (stream->seekPoints == NULL) return;
+
+    if (drmp3_calculate_seek_points(&stream->mp3, &count, stream->seekPoints) && count > 0 &&
+        drmp3_bind_seek_table(&stream->mp3, count, stream->seekPoints)) {
+        stream->seekPointCount = count;
+        stream->bytes += count * sizeof(drmp3_seek_point);
+    } else {
+        free(stream->seekPoints);
+        stream->seekPoints = NULL;
+    }
+
+    // The scans may leave the decoder anywhere; reads start at frame 0
+    drmp3_seek_to_pcm_frame(&stream->mp3, 0);
+}
+
+// Opens the file with dr_wav or dr_mp3 on a new stream of the track. dr_wav
+// goes first: it only accepts a RIFF header, where MP3 sync words could
+// turn up inside a WAV's samples.
+static bool open_decoder(PlayerTrack *track, const char *path) {
+    PlayerStream *stream = (PlayerStream *)calloc(1, sizeof(PlayerStream));
+    if (stream == NULL) return false;
+    stream->bytes = sizeof(PlayerStream);
+
+    if (drwav_init_file(&stream->wav, path, NULL)) {
+        stream->decoder = DECODER_WAV;
+        track->sourceRate = stream->wav.sampleRate;
+        track->sourceBits = stream->wav.bitsPerSample;
+        stream->sourceFrames = stream->wav.totalPCMFrameCount;
+        stream->channels = stream->wav.channels;
+    } else if (drmp3_init_file(&stream->mp3, path, NULL)) {
+        stream->decoder = DECODER_MP3;
+        track->sourceRate = stream->mp3.sampleRate;
+        track->sourceBits = 32; // Decoded to float
+        stream->sourceFrames = drmp3_get_pcm_frame_count(&stream->mp3);
+        stream->channels = stream->mp3.channels;
+        bind_seek_table(stream);
+    }
+
+    if (stream->decoder == DECODER_NONE || stream->sourceFrames == 0 || stream->channels == 0) {
+        close_stream(stream);
+        return false;
+    }
+    track->stream = stream;
+    return true;
+}
+
+// Sets the track's length at the output rate. A mapped or decoded source at
+// the output rate is read in place; anything else gets a stream, resampling
+// if needed, and its head decoded here so the decode thread starts the
+// track without waiting on the decoder. A decoder's stream is already open.
+// False if the resampler refuses the rate pair or memory runs out; the
+// stream is closed then.
+static bool open_stream(PlayerTrack *track, unsigned int rate, uint64_t sourceFrames, unsigned int channels) {
+    bool decoder = track->stream != NULL;
+    if (rate == outputRate && !decoder) {
+        track->frameCount = sourceFrames;
+        return true;
+    }
+
+    PlayerStream *stream = track->stream;
+    if (!decoder) {
+        stream = (PlayerStream *)calloc(1, sizeof(PlayerStream));
+        if (stream == NULL) return false;
+        stream->bytes = sizeof(PlayerStream);
+    }
+    stream->sourceFrames = sourceFrames;
+    stream->channels = channels;
+    track->frameCount = sourceFrames;
+    track->stream = stream;
+
+    bool ok = true;
+    if (rate != outputRate) {
+        stream->resampling = resampler_init(&stream->resampler, rate, outputRate, player_resample_quality());
+        ok = stream->resampling;
+    }
+    if (ok && stream->resampling) {
+        // Input frames one block of output can reach
+        const Resampler *resampler = &stream->resampler;
+        size_t span = (size_t)((uint64_t)(RESAMPLE_BLOCK - 1) * resampler->down / resampler->up) + resampler->taps + 2;
+
+        track->frameCount = resampler_output_frames(resampler, sourceFrames);
+        stream->window = stream_alloc(stream, span * PLAYER_CHANNELS);
+        stream->planar = stream_alloc(stream, span);
+        stream->converted = stream_alloc(stream, RESAMPLE_BLOCK);
+        stream->block = stream_alloc(stream, (size_t)RESAMPLE_BLOCK * PLAYER_CHANNELS);
+        ok = stream->window != NULL && stream->planar != NULL && stream->converted != NULL && stream->block != NULL;
+    }
+    if (ok && decoder) {
+        stream->scratch = stream_alloc(stream, (size_t)PLAYER_DECODE_CHUNK * channels);
+        ok = stream->scratch != NULL;
+    }
+
+    uint64_t headFrames = track->frameCount < PLAYER_RING_FRAMES ? track->frameCount : PLAYER_RING_FRAMES;
+    if (ok) {
+        stream->head = stream_alloc(stream, (size_t)headFrames * PLAYER_CHANNELS);
+        ok = stream->head != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to set up streaming for %s\n", track->path);
+        close_stream(stream);
+        track->stream = NULL;
+        return false;
+    }
+
+    read_stream(track, 0, stream->head, headFrames);
+    stream->headFrames = headFrames;
+    return true;
+}
+
+PlayerTrack* player_load_track(const char *path) {
+    // Before opening, so an edit made meanwhile invalidates the cached copy
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return NULL;
+    }
+
+    PlayerTrack *track = (PlayerTrack *)calloc(1, sizeof(PlayerTrack));
+    if (track == NULL) {
+        fprintf(stderr, "Failed to allocate memory for track %s\n", path);
+        return NULL;
+    }
+    set_source(track, path, &st);
+
+    // PCM WAV: no decode. Frames come from the page cache, converted to the
+    // output rate as they are read if the file is at another
+    if (wav_map_open(&track->map, path)) {
+        track->sourceRate = track->map.sampleRate;
+        track->sourceBits = track->map.bitsPerSample;
+        track->mapped = true;
+        if (track->map.channels <= PLAYER_CHANNELS &&
+            open_stream(track, track->map.sampleRate, track->map.frameCount, track->map.channels)) {
+            return track;
+        }
+        wav_map_close(&track->map);
+        track->mapped = false;
+    }
+
+    // MP3 and other WAVs: decoded a chunk at a time on the decode thread
+    if (open_decoder(track, path) &&
+        open_stream(track, track->sourceRate, track->stream->sourceFrames, track->stream->channels)) {
+        return track;
+    }
+
+    // Anything else is decoded in full
+    Wave wave = LoadWave(path);
+    if (wave.data == NULL || wave.frameCount == 0) {
+        fprintf(stderr, "Failed to decode %s\n", path);
+        UnloadWave(wave);
+        free(track);
+        return NULL;
+    }
+
+    track->sourceRate = wave.sampleRate;
+    track->sourceBits = wave.sampleSize;
+
+    // Convert once here so the decode thread only has to scale samples;
+    // raylib's converter takes rate pairs the resampler refuses
+    WaveFormat(&wave, wave.sampleRate, 16, PLAYER_CHANNELS);
+    track->wave = wave;
+    track->frames = (const int16_t *)wave.data;
+    if (!open_stream(track, wave.sampleRate, wave.frameCount, PLAYER_CHANNELS)) {
+        WaveFormat(&track->wave, (int)outputRate, 16, PLAYER_CHANNELS);
+        track->frames = (const int16_t *)track->wave.data;
+        track->frameCount = track->wave.frameCount;
+    }
+    return track;
+}
+
+void player_unload_track(PlayerTrack *track) {
+    if (track == NULL) return;
+    close_stream(track->stream);
+    if (track->mapped) wav_map_close(&track->map);
+    if (track->wave.data != NULL) UnloadWave(track->wave);
+    free(track);
+}
+
+size_t player_track_bytes(const PlayerTrack *track) {
+    size_t bytes = track->stream != NULL ? track->stream->bytes : 0;
+
+    // Decoded in full, at the file's rate if resampled on the way
+    bool decoder = track->stream != NULL && track->stream->decoder != DECODER_NONE;
+    if (!track->mapped && !decoder) {
+        uint64_t frames = track->stream != NULL ? track->stream->sourceFrames : track->frameCount;
+        bytes += (size_t)frames * PLAYER_CHANNELS * sizeof(int16_t);
+    }
+    return bytes;
+}
+
+#ifdef UNIT_TESTING
+uint32_t player_track_seek_points(const PlayerTrack *track) {
+    return track->stream != NULL ? track->stream->seekPointCount : 0;
+}
+#endif
+
+void player_set_resample_quality(ResampleQuality quality) {
+    if (quality >= RESAMPLE_QUALITY_COUNT) return;
+    __atomic_store_n(&resampleQuality, (int)quality, __ATOMIC_RELAXED);
+}
+
+ResampleQuality player_resample_quality(void) {
+    return (ResampleQuality)__atomic_load_n(&resampleQuality, __ATOMIC_RELAXED);
+}
+
+static void stream_callback(void *bufferData, unsigned int frames) {
+    ALLOC_TRACKER_NAME_THREAD("audio");
+    player_mix((float *)bufferData, frames);
+}
+
+static void* decode_thread(void *arg) {
+    (void)arg;
+    ALLOC_TRACKER_NAME_THREAD("decode");
+
+    const struct timespec period = { 0, PLAYER_DECODE_PERIOD_MS * 1000000L };
+    while (__atomic_load_n(&decodeRunning, __ATOMIC_ACQUIRE)) {
+        player_decode();
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+static void start_decode_thread(void) {
+    decodeRunning = true;
+    if (pthread_create(&decodeThread, NULL, decode_thread, NULL) != 0) {
+        fprintf(stderr, "Failed to start the decode thread\n");
+        decodeRunning = false;
+        return;
+    }
+
+    // Real-time priority where the system grants it; the default otherwise
+    struct sched_param param = { .sched_priority = sched_get_priority_min(SCHED_FIFO) };
+    pthread_setschedparam(decodeThread, SCHED_FIFO, &param);
+}
+
+unsigned int player_output_rate(void) {
+    return outputRate;
+}
+
+void player_init(AudioCallback *processors) {
+    // Every track is converted to this one rate on the decode thread; when
+    // it matches the device's, raylib passes the frames straight through
+    output = LoadAudioStream(outputRate, 32, PLAYER_CHANNELS);
+    SetAudioStreamCallback(output, stream_callback);
+    for (AudioCallback *processor = processors; processor != NULL && *processor != NULL; ++processor) {
+        AttachAudioStreamProcessor(output, *processor);
+    }
+    SetAudioStreamVolume(output, 0.5f);
+
+    start_decode_thread();
+    PlayAudioStream(output);
+}
+
+void player_shutdown(void) {
+    if (decodeRunning) {
+        __atomic_store_n(&decodeRunning, false, __ATOMIC_RELEASE);
+        pthread_join(decodeThread, NULL);
+    }
+    UnloadAudioStream(output);
+
+    // Neither thread can run any more
+    for (size_t i = 0; i < retiredCount; ++i) {
+        player_unload_track(retired[i].track);
+    }
+    retiredCount = 0;
+}
+
+static void read_frames(const PlayerTrack *track, uint64_t frame, float *out, uint64_t frames) {
+    PlayerStream *stream = track->stream;
+    if (stream != NULL) {
+        // The head first, so a track starts without waiting on its decoder
+        if (frame < stream->headFrames) {
+            uint64_t count = stream->headFrames - frame < frames ? stream->headFrames - frame : frames;
+            memcpy(out, stream->head + frame * PLAYER_CHANNELS, (size_t)count * PLAYER_CHANNELS * sizeof(float));
+            out += count * PLAYER_CHANNELS;
+            frame += count;
+            frames -= count;
+        }
+        if (frames > 0) read_stream(track, frame, out, frames);
+        return;
+    }
+
+    if (track->mapped) {
+        wav_map_read_float(&track->map, frame, out, (size_t)frames, PLAYER_CHANNELS);
+        return;
+    }
+
+    const int16_t *in = track->frames + frame * PLAYER_CHANNELS;
+    for (uint64_t i = 0; i < frames * PLAYER_CHANNELS; ++i) {
+        out[i] = (float)in[i] * (1.0f / 32768.0f);
+    }
+}
+
+static bool push_marker(uint64_t position, PlayerTrack *track, uint64_t frame, bool ended) {
+    uint64_t read = __atomic_load_n(&markerRead, __ATOMIC_ACQUIRE);
+    if (markerWrite - read == PLAYER_MARKERS) return false;
+
+    RingMarker *marker = &markers[markerWrite % PLAYER_MARKERS];
+    marker->position = position;
+    marker->track = track;
+    marker->frame = frame;
+    marker->serial = decodeSerial;
+    marker->ended = ended;
+    __atomic_store_n(&markerWrite, markerWrite + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+size_t player_decode(void) {
+    uint64_t write = ringWrite;
+
+    // A full marker queue only happens while the device is stopped; the
+    // request is then picked up on a later pass
+    if (__atomic_load_n(&pendingRequest, __ATOMIC_RELAXED) != NULL &&
+        markerWrite - __atomic_load_n(&markerRead, __ATOMIC_ACQUIRE) < PLAYER_MARKERS) {
+        PlayerRequest *request = __atomic_exchange_n(&pendingRequest, NULL, __ATOMIC_ACQUIRE);
+        decodeTrack = request->track;
+        decodeFrame = request->frame;
+        decodeAdvised = 0;
+        decodeSerial = request->serial;
+        decodeEnded = false;
+        fadeTrack = NULL;
+
+        // Whatever is still buffered belongs to the old request
+        __atomic_store_n(&ringFlush, write, __ATOMIC_RELEASE);
+        push_marker(write, decodeTrack, decodeFrame, false);
+    }
+
+    // A successor queued after the track ran out still follows it directly
+    // in the ring, and so without a gap if the device has not caught up yet
+    if (decodeTrack == NULL && decodeEnded && __atomic_load_n(&nextTrack, __ATOMIC_RELAXED) != NULL &&
+        markerWrite - __atomic_load_n(&markerRead, __ATOMIC_ACQUIRE) < PLAYER_MARKERS) {
+        PlayerTrack *successor = __atomic_exchange_n(&nextTrack, NULL, __ATOMIC_ACQUIRE);
+        if (successor != NULL) {
+            decodeTrack = successor;
+            decodeFrame = 0;
+            decodeAdvised = 0;
+            decodeEnded = false;
+            push_marker(write, decodeTrack, 0, false);
+        }
+    }
+
+    uint64_t space = PLAYER_RING_FRAMES - (write - __atomic_load_n(&ringRead, __ATOMIC_ACQUIRE));
+    size_t written = 0;
+
+    uint64_t crossfade = __atomic_load_n(&crossfadeFrames, __ATOMIC_RELAXED);
+
+    while (space > 0 && decodeTrack != NULL) {
+        uint64_t left = decodeTrack->frameCount > decodeFrame ? decodeTrack->frameCount - decodeFrame : 0;
+
+        // Within the crossfade window of the end: the successor starts
+        // here, and the rest of this track is mixed in under it
+        if (fadeTrack == NULL && left > 0 && left <= crossfade &&
+            __atomic_load_n(&nextTrack, __ATOMIC_RELAXED) != NULL &&
+            markerWrite - __atomic_load_n(&markerRead, __ATOMIC_ACQUIRE) < PLAYER_MARKERS) {
+            PlayerTrack *successor = __atomic_exchange_n(&nextTrack, NULL, __ATOMIC_ACQUIRE);
+            if (successor != NULL) {
+                fadeTrack = decodeTrack;
+                fadeFrame = decodeFrame;
+                fadePosition = 0;
+                fadeLength = left < successor->frameCount ? left : successor->frameCount;
+                if (fadeTrack->mapped && fadeTrack->stream == NULL) wav_map_advise(&fadeTrack->map, fadeFrame, fadeLength);
+
+                decodeTrack = successor;
+                decodeFrame = 0;
+                decodeAdvised = 0;
+                push_marker(write, decodeTrack, 0, false);
+                left = decodeTrack->frameCount;
+            }
+        }
+
+        uint64_t offset = write % PLAYER_RING_FRAMES;
+        uint64_t count = left < space ? left : space;
+        if (count > PLAYER_RING_FRAMES - offset) count = PLAYER_RING_FRAMES - offset;
+        if (fadeTrack != NULL && count > fadeLength - fadePosition) count = fadeLength - fadePosition;
+        if (fadeTrack == NULL && left > crossfade && count > left - crossfade) count = left - crossfade; // Stop where the fade starts
+
+        // Page in the stretch of a mapped file that comes after this one
+        if (decodeTrack->mapped && decodeTrack->stream == NULL && decodeFrame + count > decodeAdvised) {
+            wav_map_advise(&decodeTrack->map, decodeFrame, WAV_MAP_READAHEAD_FRAMES);
+            decodeAdvised = decodeFrame + WAV_MAP_READAHEAD_FRAMES / 2;
+        }
+
+        read_frames(decodeTrack, decodeFrame, ring + offset * PLAYER_CHANNELS, count);
+        if (fadeTrack != NULL) {
+            read_frames(fadeTrack, fadeFrame, fadeBuffer, count);
+            player_crossfade(ring + offset * PLAYER_CHANNELS, fadeBuffer, (size_t)count, fadePosition, fadeLength);
+            fadeFrame += count;
+            fadePosition += count;
+            if (fadePosition == fadeLength) fadeTrack = NULL;
+        }
+        write += count;
+        space -= count;
+        written += count;
+        decodeFrame += count;
+
+        if (decodeFrame >= decodeTrack->frameCount) {
+            // Carry on with the successor from the very next frame
+            if (markerWrite - __atomic_load_n(&markerRead, __ATOMIC_ACQUIRE) == PLAYER_MARKERS) break;
+            PlayerTrack *successor = __atomic_exchange_n(&nextTrack, NULL, __ATOMIC_ACQUIRE);
+            push_marker(write, successor, 0, successor == NULL);
+            decodeTrack = successor;
+            decodeFrame = 0;
+            decodeAdvised = 0;
+            decodeEnded = successor == NULL;
+        }
+    }
+
+    __atomic_store_n(&ringWrite, write, __ATOMIC_RELEASE);
+    // Fading track first: whoever sees the track that took over sees it too
+    __atomic_store_n(&fadingTrack, fadeTrack, __ATOMIC_RELEASE);
+    __atomic_store_n(&decodingTrack, decodeTrack, __ATOMIC_RELEASE);
+    __atomic_store_n(&decodeCount, decodeCount + 1, __ATOMIC_RELEASE);
+    return written;
+}
+
+void player_mix(float *out, unsigned int frames) {
+    uint64_t read = ringRead;
+    uint64_t flush = __atomic_load_n(&ringFlush, __ATOMIC_ACQUIRE);
+    if (flush > read) read = flush;
+
+    uint64_t available = __atomic_load_n(&ringWrite, __ATOMIC_ACQUIRE) - read;
+    uint64_t count = available < frames ? available : frames;
+
+    for (uint64_t copied = 0; copied < count; ) {
+        uint64_t offset = (read + copied) % PLAYER_RING_FRAMES;
+        uint64_t chunk = count - copied;
+        if (chunk > PLAYER_RING_FRAMES - offset) chunk = PLAYER_RING_FRAMES - offset;
+        memcpy(out + copied * PLAYER_CHANNELS, ring + offset * PLAYER_CHANNELS,
+               chunk * PLAYER_CHANNELS * sizeof(float));
+        copied += chunk;
+    }
+    if (count < frames) {
+        memset(out + count * PLAYER_CHANNELS, 0, (frames - count) * PLAYER_CHANNELS * sizeof(float));
+    }
+    read += count;
+    __atomic_store_n(&ringRead, read, __ATOMIC_RELEASE);
+
+    // Every segment that has started by now, the last one being current
+    uint64_t markersWritten = __atomic_load_n(&markerWrite, __ATOMIC_ACQUIRE);
+    while (markerRead < markersWritten && markers[markerRead % PLAYER_MARKERS].position <= read) {
+        segment = markers[markerRead % PLAYER_MARKERS];
+        __atomic_store_n(&markerRead, markerRead + 1, __ATOMIC_RELEASE);
+    }
+
+    // The decode thread fell behind in the middle of a track
+    if (count < frames && segment.track != NULL) {
+        __atomic_store_n(&underrunCount, underrunCount + 1, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&playingFrame, segment.track != NULL ? segment.frame + (read - segment.position) : 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&trackEnded, segment.ended, __ATOMIC_RELAXED);
+    __atomic_store_n(&appliedSerial, segment.serial, __ATOMIC_RELEASE);
+    __atomic_store_n(&playingTrack, segment.track, __ATOMIC_RELEASE);
+}
+
+static void submit_request(PlayerTrack *track, uint64_t frame) {
+    // Slots are reused PLAYER_REQUESTS requests later, long after the decode
+    // thread has read them
+    PlayerRequest *request = &requests[requestHead];
+    requestHead = (requestHead + 1) % PLAYER_REQUESTS;
+
+    request->track = track;
+    request->frame = frame;
+    request->serial = ++requestSerial;
+    __atomic_store_n(&pendingRequest, request, __ATOMIC_RELEASE);
+}
+
+void player_play(PlayerTrack *track, uint64_t frame) {
+    __atomic_store_n(&nextTrack, NULL, __ATOMIC_RELEASE);
+    submit_request(track, frame);
+}
+
+void player_set_next(PlayerTrack *track) {
+    __atomic_store_n(&nextTrack, track, __ATOMIC_RELEASE);
+}
+
+void player_set_crossfade(float seconds) {
+    if (seconds < 0.0f) seconds = 0.0f;
+    if (seconds > PLAYER_MAX_CROSSFADE_SECONDS) seconds = PLAYER_MAX_CROSSFADE_SECONDS;
+    __atomic_store_n(&crossfadeFrames, (uint64_t)(seconds * outputRate), __ATOMIC_RELAXED);
+}
+
+float player_crossfade_seconds(void) {
+    return (float)__atomic_load_n(&crossfadeFrames, __ATOMIC_RELAXED) / outputRate;
+}
+
+float player_step_crossfade(void) {
+    static const float presets[] = { 0.0f, 2.0f, 5.0f, PLAYER_MAX_CROSSFADE_SECONDS };
+
+    // The first preset above the current length, so a length set some other
+    // way still moves up one step
+    float current = player_crossfade_seconds();
+    float next = presets[0];
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); ++i) {
+        if (presets[i] > current + 0.01f) {
+            next = presets[i];
+            break;
+        }
+    }
+    player_set_crossfade(next);
+    return player_crossfade_seconds();
+}
+
+void player_crossfade(float *incoming, const float *outgoing, size_t frames, uint64_t position, uint64_t length) {
+    const float quarter = 1.5707963f; // Gains follow a quarter turn: cos² + sin² = 1
+    const float step = quarter / (float)length;
+    const vf4 rotateCos = vf4_set1(cosf(2.0f * step));
+    const vf4 rotateSin = vf4_set1(sinf(2.0f * step));
+
+    size_t frame = 0;
+    while (frame + 1 < frames) {
+        // Exact gains at the start of every block, then a rotation per frame
+        // pair; the drift within a block stays far below 16-bit resolution
+        size_t blockEnd = frame + PLAYER_CROSSFADE_BLOCK < frames ? frame + PLAYER_CROSSFADE_BLOCK : frames;
+        float angle = step * (float)(position + frame);
+        vf4 gainOut = vf4_setr(cosf(angle), cosf(angle), cosf(angle + step), cosf(angle + step));
+        vf4 gainIn = vf4_setr(sinf(angle), sinf(angle), sinf(angle + step), sinf(angle + step));
+
+        for (; frame + 1 < blockEnd; frame += 2) {
+            float *in = incoming + frame * PLAYER_CHANNELS;
+            const float *out = outgoing + frame * PLAYER_CHANNELS;
+            vf4_store(in, vf4_madd(vf4_mul(vf4_load(in), gainIn), vf4_load(out), gainOut));
+
+            vf4 nextOut = vf4_sub(vf4_mul(gainOut, rotateCos), vf4_mul(gainIn, rotateSin));
+            gainIn = vf4_madd(vf4_mul(gainIn, rotateCos), gainOut, rotateSin);
+            gainOut = nextOut;
+        }
+    }
+
+    // Odd frame left over
+    for (; frame < frames; ++frame) {
+        float angle = step * (float)(position + frame);
+        for (int c = 0; c < PLAYER_CHANNELS; ++c) {
+            size_t i = frame * PLAYER_CHANNELS + c;
+            incoming[i] = incoming[i] * sinf(angle) + outgoing[i] * cosf(angle);
+        }
+    }
+}
+
+void player_set_paused(bool paused) {
+    if (paused) {
+        PauseAudioStream(output);
+    } else {
+        ResumeAudioStream(output);
+    }
+}
+
+static bool is_retired(const PlayerTrack *track) {
+    for (size_t i = 0; i < retiredCount; ++i) {
+        if (retired[i].track == track) return true;
+    }
+    return false;
+}
+
+static uint64_t seek_frame(const PlayerTrack *track, float seconds) {
+    uint64_t frame = seconds > 0.0f ? (uint64_t)(seconds * outputRate) : 0;
+    return frame < track->frameCount ? frame : track->frameCount;
+}
+
+void player_seek(float seconds) {
+    PlayerTrack *track = player_playing_track();
+    if (track == NULL || is_retired(track)) return;
+
+    scrubFrame = UINT64_MAX;
+    submit_request(track, seek_frame(track, seconds));
+}
+
+void player_scrub(float seconds, bool final) {
+    PlayerTrack *track = player_playing_track();
+    if (track == NULL || is_retired(track)) return;
+
+    uint64_t frame = seek_frame(track, seconds);
+    if (frame == scrubFrame) {
+        if (final) scrubFrame = UINT64_MAX;
+        return;
+    }
+
+    // Every request flushes the ring, so send at most one per audio period:
+    // until the device has reached the last one, newer positions just
+    // replace each other in the caller
+    if (!final && __atomic_load_n(&appliedSerial, __ATOMIC_ACQUIRE) != requestSerial) return;
+
+    scrubFrame = final ? UINT64_MAX : frame;
+    submit_request(track, frame);
+}
+
+void player_release(PlayerTrack *track) {
+    if (track == NULL) return;
+
+    PlayerTrack *expected = track;
+    __atomic_compare_exchange_n(&nextTrack, &expected, NULL, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+
+    if (retiredCount == PLAYER_RETIRED_TRACKS) {
+        player_reclaim();
+    }
+    if (retiredCount == PLAYER_RETIRED_TRACKS) {
+        // Only possible with the device stalled; leaking beats a use-after-free
+        fprintf(stderr, "Player: too many released tracks, leaking %s\n", track->path);
+        return;
+    }
+
+    RetiredTrack *entry = &retired[retiredCount++];
+    entry->track = track;
+    entry->decodes = __atomic_load_n(&decodeCount, __ATOMIC_ACQUIRE);
+    entry->drained = false;
+    entry->drainPosition = 0;
+}
+
+void player_reclaim(void) {
+    uint64_t decodes = __atomic_load_n(&decodeCount, __ATOMIC_ACQUIRE);
+    PlayerTrack *decoding = __atomic_load_n(&decodingTrack, __ATOMIC_ACQUIRE);
+    PlayerTrack *fading = __atomic_load_n(&fadingTrack, __ATOMIC_ACQUIRE);
+    uint64_t read = __atomic_load_n(&ringRead, __ATOMIC_ACQUIRE);
+    PlayerTrack *playing = __atomic_load_n(&playingTrack, __ATOMIC_ACQUIRE);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < retiredCount; ++i) {
+        RetiredTrack *entry = &retired[i];
+
+        // A decode pass that started after the release has completed
+        // without the track, and nothing can hand it back to the decoder.
+        // Frames and markers it already wrote end at the current write
+        // position.
+        if (!entry->drained && decodes >= entry->decodes + 2 &&
+            decoding != entry->track && fading != entry->track) {
+            entry->drained = true;
+            entry->drainPosition = __atomic_load_n(&ringWrite, __ATOMIC_ACQUIRE);
+        }
+
+        // Once the device is past them, the audio thread cannot publish it
+        if (entry->drained && read >= entry->drainPosition && playing != entry->track) {
+            ALLOC_TRACKER_ALLOW_FRAME();
+            track_cache_put(entry->track);
+        } else {
+            retired[kept++] = *entry;
+        }
+    }
+    retiredCount = kept;
+}
+
+PlayerTrack* player_playing_track(void) {
+    return __atomic_load_n(&playingTrack, __ATOMIC_ACQUIRE);
+}
+
+bool player_finished(void) {
+    // A request the device has not reached yet supersedes the old state
+    if (__atomic_load_n(&appliedSerial, __ATOMIC_ACQUIRE) != requestSerial) return false;
+    return __atomic_load_n(&trackEnded, __ATOMIC_RELAXED);
+}
+
+float player_time_played(void) {
+    return (float)__atomic_load_n(&playingFrame, __ATOMIC_RELAXED) / (float)outputRate;
+}
+
+float player_time_length(void) {
+    PlayerTrack *track = player_playing_track();
+    return track != NULL ? (float)track->frameCount / (float)outputRate : 0.0f;
+}
+
+float player_buffered_ms(void) {
+    uint64_t write = __atomic_load_n(&ringWrite, __ATOMIC_ACQUIRE);
+    uint64_t read = __atomic_load_n(&ringRead, __ATOMIC_ACQUIRE);
+    return write > read ? (float)(write - read) * 1000.0f / (float)outputRate : 0.0f;
+}
+
+uint64_t player_underruns(void) {
+    return __atomic_load_n(&underrunCount, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,143 @@
+// probe.c
+//
+// Background probing of dropped files. Dropping a folder queues every file
+// at once; checking them one by one on the render loop would stall the
+// window. The render loop only submits paths and collects verdicts, while
+// a few workers open the files. Jobs and results share one ring under a
+// mutex: a job becomes a result in place, and its slot is reused only once
+// the result has been collected.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/probe.h"
+#include "../../include/alloc_tracker.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    PROBE_QUEUED,
+    PROBE_RUNNING,
+    PROBE_DONE
+} ProbeState;
+
+typedef struct {
+    ProbeState state;
+    bool playable;
+    void *tag;
+    char path[1024];
+} ProbeJob;
+
+static ProbeJob jobs[PROBE_QUEUE];
+static unsigned long jobHead = 0;     /**< Oldest job not yet collected */
+static unsigned long jobNext = 0;     /**< Oldest job not yet picked up */
+static unsigned long jobTail = 0;     /**< One past the newest job */
+static bool running = false;
+static pthread_t workers[PROBE_WORKERS];
+static int workerCount = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+
+bool probe_audio_file(const char *path) {
+    unsigned char header[12];
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    size_t size = fread(header, 1, sizeof(header), file);
+    fclose(file);
+
+    if (size == sizeof(header) && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0) {
+        return true;
+    }
+    if (size >= 3 && memcmp(header, "ID3", 3) == 0) {
+        return true;
+    }
+    // MPEG audio frame sync, with a valid layer
+    return size >= 2 && header[0] == 0xFF && (header[1] & 0xE0) == 0xE0 && (header[1] & 0x06) != 0;
+}
+
+static void* probe_thread(void *arg) {
+    (void)arg;
+    ALLOC_TRACKER_NAME_WORKER("probe");
+
+    pthread_mutex_lock(&lock);
+    while (running) {
+        if (jobNext == jobTail) {
+            pthread_cond_wait(&wake, &lock);
+            continue;
+        }
+
+        // Nobody else touches a running job, so it is probed unlocked
+        ProbeJob *job = &jobs[jobNext++ % PROBE_QUEUE];
+        job->state = PROBE_RUNNING;
+        pthread_mutex_unlock(&lock);
+
+        bool playable = probe_audio_file(job->path);
+
+        pthread_mutex_lock(&lock);
+        job->playable = playable;
+        job->state = PROBE_DONE;
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+void probe_init(void) {
+    running = true;
+    for (int i = 0; i < PROBE_WORKERS; ++i) {
+        if (pthread_create(&workers[workerCount], NULL, probe_thread, NULL) != 0) {
+            fprintf(stderr, "Failed to start probe worker %d\n", i);
+            break;
+        }
+        workerCount++;
+    }
+    if (workerCount == 0) running = false;
+}
+
+void probe_shutdown(void) {
+    pthread_mutex_lock(&lock);
+    running = false;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < workerCount; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    workerCount = 0;
+    jobHead = jobNext = jobTail = 0;
+}
+
+bool probe_submit(const char *path, void *tag) {
+    pthread_mutex_lock(&lock);
+    if (!running || jobTail - jobHead == PROBE_QUEUE) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+    ProbeJob *job = &jobs[jobTail++ % PROBE_QUEUE];
+    job->state = PROBE_QUEUED;
+    job->playable = false;
+    job->tag = tag;
+    strncpy(job->path, path, sizeof(job->path) - 1);
+    job->path[sizeof(job->path) - 1] = '\0';
+
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+bool probe_collect(ProbeResult *result) {
+    bool found = false;
+
+    // In submission order: probes only read a header, so one slow file
+    // holds the others back by little
+    pthread_mutex_lock(&lock);
+    if (jobHead != jobNext && jobs[jobHead % PROBE_QUEUE].state == PROBE_DONE) {
+        ProbeJob *job = &jobs[jobHead++ % PROBE_QUEUE];
+        result->tag = job->tag;
+        result->playable = job->playable;
+        found = true;
+    }
+    pthread_mutex_unlock(&lock);
+    return found;
+}
@@ -0,0 +1,126 @@
+// track_cache.c
+//
+// Recently played tracks, kept open with their prefetched or decoded frames
+// so that going back to one or replaying it starts without loading it
+// again. A track lives either in the cache or with its user, never both:
+// put hands ownership over and take hands it back. Entries are keyed by
+// path and validated against the file's modification time and size, so an
+// edited file is opened afresh.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/track_cache.h"
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct {
+    PlayerTrack *track;
+    uint64_t used;            /**< Use stamp; the lowest is evicted first */
+} CacheEntry;
+
+static CacheEntry entries[TRACK_CACHE_ENTRIES];
+static size_t entryCount = 0;
+static size_t heldBytes = 0;
+static size_t limitBytes = (size_t)TRACK_CACHE_MB * 1024 * 1024;
+static uint64_t useCount = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Removes an entry without freeing its track; the lock must be held
+static PlayerTrack* remove_entry(size_t index) {
+    PlayerTrack *track = entries[index].track;
+    heldBytes -= player_track_bytes(track);
+    entries[index] = entries[--entryCount];
+    return track;
+}
+
+static size_t least_recent(void) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < entryCount; ++i) {
+        if (entries[i].used < entries[oldest].used) oldest = i;
+    }
+    return oldest;
+}
+
+// Evicts until `incoming` more bytes and one more entry fit; the lock must be held
+static void make_room(size_t incoming) {
+    while (entryCount > 0 && (entryCount == TRACK_CACHE_ENTRIES || heldBytes + incoming > limitBytes)) {
+        player_unload_track(remove_entry(least_recent()));
+    }
+}
+
+void track_cache_set_limit(size_t bytes) {
+    pthread_mutex_lock(&lock);
+    limitBytes = bytes;
+    while (entryCount > 0 && heldBytes > limitBytes) {
+        player_unload_track(remove_entry(least_recent()));
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void track_cache_put(PlayerTrack *track) {
+    if (track == NULL) return;
+
+    pthread_mutex_lock(&lock);
+
+    size_t bytes = player_track_bytes(track);
+    if (bytes > limitBytes) {
+        pthread_mutex_unlock(&lock);
+        player_unload_track(track);
+        return;
+    }
+
+    // The same file queued twice comes back twice; keep the newer copy
+    for (size_t i = 0; i < entryCount; ++i) {
+        if (strcmp(entries[i].track->path, track->path) == 0) {
+            player_unload_track(remove_entry(i));
+            break;
+        }
+    }
+
+    make_room(bytes);
+    entries[entryCount].track = track;
+    entries[entryCount].used = ++useCount;
+    entryCount++;
+    heldBytes += bytes;
+
+    pthread_mutex_unlock(&lock);
+}
+
+PlayerTrack* track_cache_take(const char *path) {
+    // Outside the lock: a slow file system must not stall a put from the render loop
+    struct stat st;
+    bool exists = stat(path, &st) == 0;
+
+    PlayerTrack *track = NULL;
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < entryCount; ++i) {
+        if (strcmp(entries[i].track->path, path) == 0) {
+            track = remove_entry(i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (track != NULL && (!exists || (int64_t)st.st_mtime != track->modified ||
+                          (uint64_t)st.st_size != track->fileSize)) {
+        player_unload_track(track);
+        track = NULL;
+    }
+    return track;
+}
+
+void track_cache_clear(void) {
+    pthread_mutex_lock(&lock);
+    while (entryCount > 0) {
+        player_unload_track(remove_entry(entryCount - 1));
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+size_t track_cache_bytes(void) {
+    pthread_mutex_lock(&lock);
+    size_t bytes = heldBytes;
+    pthread_mutex_unlock(&lock);
+    return bytes;
+}
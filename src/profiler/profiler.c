@@ -0,0 +1,241 @@
+// profiler.c
+//
+// Per-stage frame timers and a trace-event recorder. Everything here is
+// compiled only with ENABLE_PROFILER (make PROFILE=1); otherwise the
+// PROFILE_* macros expand to nothing and this file is empty.
+//
+// Each thread owns one trace ring and is its only writer, so recording is a
+// store into preallocated memory plus a release store of the head index.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../../include/profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROFILER_STATS_INTERVAL 15 // Frames between percentile updates
+
+static const char *stage_names[PROFILE_STAGE_COUNT] = {
+    "Frame",
+    "File drop",
+    "Input",
+    "Playback",
+    "Analysis",
+    "  Window",
+    "  FFT",
+    "  Bands",
+    "  Multi-res",
+    "  Scale",
+    "DrawUI",
+    "  Progress",
+    "  Bar chart",
+    "  Iridescent",
+    "  Time tunnel",
+    "  Queue",
+    "  Controls",
+    "Present",
+    "Audio callback",
+    "Loudness meter",
+};
+
+// Producer must not be within this many events of what a dump is reading
+#define TRACE_GUARD_EVENTS 256
+
+/**
+ * @brief One completed stage, in Chrome's "X" (complete event) form.
+ */
+typedef struct {
+    uint64_t begin;           /**< Start time (ns, monotonic clock) */
+    uint64_t end;             /**< End time (ns) */
+    uint32_t stage;           /**< ProfileStage */
+} TraceEvent;
+
+/**
+ * @brief Single-producer event ring.
+ */
+typedef struct {
+    TraceEvent *events;
+    size_t capacity;          /**< Power of two */
+    uint64_t head;            /**< Events ever written; published with release */
+    int tid;                  /**< Thread id in the exported trace */
+    const char *threadName;
+} TraceRing;
+
+static TraceEvent main_events[PROFILER_MAIN_EVENTS];
+static TraceEvent audio_events[PROFILER_AUDIO_EVENTS];
+static TraceRing main_ring = { main_events, PROFILER_MAIN_EVENTS, 0, 1, "Render loop" };
+static TraceRing audio_ring = { audio_events, PROFILER_AUDIO_EVENTS, 0, 2, "Audio callback" };
+
+static uint64_t stage_start[PROFILE_STAGE_COUNT];
+static uint64_t frame_time[PROFILE_FRAME_STAGE_COUNT];
+static bool frame_ran[PROFILE_FRAME_STAGE_COUNT];
+
+static float history[PROFILE_FRAME_STAGE_COUNT][PROFILER_HISTORY];
+static size_t history_head[PROFILE_FRAME_STAGE_COUNT];
+static size_t history_count[PROFILE_FRAME_STAGE_COUNT];
+
+static ProfileStats cached_stats[PROFILE_FRAME_STAGE_COUNT];
+static unsigned int frames_since_stats = PROFILER_STATS_INTERVAL;
+
+uint64_t profiler_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void profiler_begin(ProfileStage stage) {
+    stage_start[stage] = profiler_now_ns();
+}
+
+static void trace_record(TraceRing *ring, uint64_t begin, uint64_t end, ProfileStage stage) {
+    uint64_t head = ring->head;
+    TraceEvent *event = &ring->events[head & (ring->capacity - 1)];
+    event->begin = begin;
+    event->end = end;
+    event->stage = (uint32_t)stage;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void profiler_end(ProfileStage stage) {
+    uint64_t now = profiler_now_ns();
+    uint64_t begin = stage_start[stage];
+
+    if (stage >= PROFILE_FRAME_STAGE_COUNT) {
+        trace_record(&audio_ring, begin, now, stage);
+        return;
+    }
+
+    frame_time[stage] += now - begin;
+    frame_ran[stage] = true;
+    trace_record(&main_ring, begin, now, stage);
+}
+
+void profiler_end_frame(void) {
+    for (int s = 0; s < PROFILE_FRAME_STAGE_COUNT; ++s) {
+        if (!frame_ran[s]) continue;
+
+        history[s][history_head[s]] = (float)(frame_time[s] * 1e-6);
+        history_head[s] = (history_head[s] + 1) % PROFILER_HISTORY;
+        if (history_count[s] < PROFILER_HISTORY) history_count[s]++;
+
+        frame_time[s] = 0;
+        frame_ran[s] = false;
+    }
+    frames_since_stats++;
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static void update_stats(void) {
+    float sorted[PROFILER_HISTORY];
+
+    for (int s = 0; s < PROFILE_FRAME_STAGE_COUNT; ++s) {
+        ProfileStats *stats = &cached_stats[s];
+        size_t count = history_count[s];
+        memset(stats, 0, sizeof(*stats));
+        if (count == 0) continue;
+
+        memcpy(sorted, history[s], count * sizeof(float));
+        qsort(sorted, count, sizeof(float), compare_floats);
+
+        float sum = 0.0f;
+        for (size_t i = 0; i < count; ++i) sum += sorted[i];
+
+        // Nearest-rank 99th percentile
+        size_t rank = (count * 99 + 99) / 100;
+
+        stats->min = sorted[0];
+        stats->avg = sum / (float)count;
+        stats->p99 = sorted[rank - 1];
+        stats->last = history[s][(history_head[s] + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+        stats->samples = count;
+    }
+    frames_since_stats = 0;
+}
+
+ProfileStats profiler_stats(ProfileStage stage) {
+    if ((unsigned int)stage >= PROFILE_FRAME_STAGE_COUNT) {
+        ProfileStats none = {0};
+        return none;
+    }
+    if (frames_since_stats >= PROFILER_STATS_INTERVAL) {
+        update_stats();
+    }
+    return cached_stats[stage];
+}
+
+const char* profiler_stage_name(ProfileStage stage) {
+    if ((unsigned int)stage >= PROFILE_STAGE_COUNT) return "Unknown";
+    return stage_names[stage];
+}
+
+static const char* trace_event_name(uint32_t stage) {
+    const char *name = profiler_stage_name((ProfileStage)stage);
+    while (*name == ' ') name++; // Overlay indentation
+    return name;
+}
+
+static void write_trace_events(FILE *out, TraceRing *ring, uint64_t since, bool *first) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t available = ring->capacity;
+    // The producer may keep writing; stay clear of slots it is about to reuse
+    if (ring == &audio_ring) available -= TRACE_GUARD_EVENTS;
+    uint64_t tail = head > available ? head - available : 0;
+
+    fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                 "\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", ring->tid, ring->threadName);
+    *first = false;
+
+    for (uint64_t i = tail; i < head; ++i) {
+        const TraceEvent *event = &ring->events[i & (ring->capacity - 1)];
+        if (event->end < since) continue;
+
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                     "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                trace_event_name(event->stage), ring->threadName,
+                event->begin * 1e-3, (event->end - event->begin) * 1e-3, ring->tid);
+    }
+}
+
+bool profiler_dump_trace(const char *path) {
+    // Start of the oldest frame in the export window
+    uint64_t head = main_ring.head;
+    uint64_t tail = head > main_ring.capacity ? head - main_ring.capacity : 0;
+    uint64_t since = 0;
+    int frames = 0;
+    for (uint64_t i = head; i > tail && frames < PROFILER_TRACE_FRAMES; --i) {
+        const TraceEvent *event = &main_ring.events[(i - 1) & (main_ring.capacity - 1)];
+        if (event->stage == PROFILE_FRAME) {
+            since = event->begin;
+            frames++;
+        }
+    }
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Failed to open trace file %s\n", path);
+        return false;
+    }
+
+    bool first = true;
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    write_trace_events(out, &main_ring, since, &first);
+    write_trace_events(out, &audio_ring, since, &first);
+    fprintf(out, "\n]}\n");
+    fclose(out);
+
+    printf("Wrote %d frames of trace events to %s\n", frames, path);
+    return true;
+}
+
+#endif // ENABLE_PROFILER
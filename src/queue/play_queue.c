@@ -0,0 +1,112 @@
+// play_queue.c
+//
+// Contiguous play queue. Entries live in one growing array and their
+// strings in one arena, so adding a song costs no allocation of its own
+// and jumping anywhere is an index. The play order is a permutation of
+// entry ids; moving or shuffling songs only rewrites that array.
+
+#include "../../include/play_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLAY_QUEUE_INITIAL_CAPACITY 64
+
+void play_queue_init(PlayQueue *queue) {
+    memset(queue, 0, sizeof(*queue));
+    queue->current = PLAY_QUEUE_NONE;
+}
+
+void play_queue_free(PlayQueue *queue) {
+    free(queue->entries);
+    free(queue->order);
+    string_arena_free(&queue->strings);
+    play_queue_init(queue);
+}
+
+static bool grow(PlayQueue *queue) {
+    size_t capacity = queue->capacity > 0 ? queue->capacity * 2 : PLAY_QUEUE_INITIAL_CAPACITY;
+    if (capacity > UINT32_MAX) return false;
+
+    QueueEntry *entries = (QueueEntry *)realloc(queue->entries, capacity * sizeof(QueueEntry));
+    if (entries == NULL) return false;
+    queue->entries = entries;
+
+    uint32_t *order = (uint32_t *)realloc(queue->order, capacity * sizeof(uint32_t));
+    if (order == NULL) return false;
+    queue->order = order;
+
+    queue->capacity = capacity;
+    return true;
+}
+
+size_t play_queue_append(PlayQueue *queue, const char *title, const char *path) {
+    if (queue->count == queue->capacity && !grow(queue)) {
+        fprintf(stderr, "Failed to grow the play queue past %zu songs\n", queue->count);
+        return PLAY_QUEUE_NONE;
+    }
+
+    size_t titleOffset = string_arena_add(&queue->strings, title);
+    size_t pathOffset = string_arena_add(&queue->strings, path);
+    if (titleOffset == STRING_ARENA_NONE || pathOffset == STRING_ARENA_NONE || pathOffset > UINT32_MAX) {
+        return PLAY_QUEUE_NONE;
+    }
+
+    size_t id = queue->count++;
+    QueueEntry *entry = &queue->entries[id];
+    entry->title = (uint32_t)titleOffset;
+    entry->path = (uint32_t)pathOffset;
+    entry->track = NULL;
+    entry->status = SONG_PLAYABLE;
+    entry->sampleRate = 0;
+    entry->sampleBits = 0;
+
+    queue->order[id] = (uint32_t)id;
+    return id;
+}
+
+void play_queue_move(PlayQueue *queue, size_t from, size_t to) {
+    if (from >= queue->count || to >= queue->count || from == to) return;
+
+    uint32_t moved = queue->order[from];
+    if (from < to) {
+        memmove(&queue->order[from], &queue->order[from + 1], (to - from) * sizeof(uint32_t));
+    } else {
+        memmove(&queue->order[to + 1], &queue->order[to], (from - to) * sizeof(uint32_t));
+    }
+    queue->order[to] = moved;
+
+    // Follow the current song to wherever it went
+    size_t current = queue->current;
+    if (current == PLAY_QUEUE_NONE) return;
+    if (current == from) {
+        queue->current = to;
+    } else if (from < current && current <= to) {
+        queue->current = current - 1;
+    } else if (to <= current && current < from) {
+        queue->current = current + 1;
+    }
+}
+
+// splitmix64: one multiply-xorshift step per draw, plenty for a shuffle
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+bool play_queue_shuffle(PlayQueue *queue, uint64_t seed) {
+    size_t first = queue->current == PLAY_QUEUE_NONE ? 0 : queue->current + 1;
+    if (queue->count < first + 2) return false;
+
+    // Fisher-Yates over the upcoming positions
+    uint64_t state = seed;
+    for (size_t i = queue->count - 1; i > first; --i) {
+        size_t j = first + (size_t)(next_random(&state) % (i - first + 1));
+        uint32_t swap = queue->order[i];
+        queue->order[i] = queue->order[j];
+        queue->order[j] = swap;
+    }
+    return true;
+}
@@ -0,0 +1,209 @@
+// resample.c
+//
+// Sample rate conversion for files that are not at the output rate. The
+// conversion is a rational up/down polyphase filter: a Kaiser-windowed sinc
+// is sampled once per output phase into a table, so each output frame costs
+// one dot product of `taps` floats, done four lanes at a time. The table
+// depends only on the rate pair and quality, which makes the cost per
+// second of audio fixed and known in advance.
+
+#include "../../include/resample.h"
+#include "../../include/simd.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+    const char *name;
+    unsigned int taps;             /**< Filter length when upsampling */
+    double attenuation;            /**< Stopband attenuation (dB) */
+} QualityLevel;
+
+static const QualityLevel qualityLevels[RESAMPLE_QUALITY_COUNT] = {
+    { "fast",    32,  60.0 },
+    { "medium",  64,  90.0 },
+    { "best",   128, 120.0 },
+};
+
+const char* resample_quality_name(ResampleQuality quality) {
+    return quality < RESAMPLE_QUALITY_COUNT ? qualityLevels[quality].name : "unknown";
+}
+
+static unsigned int gcd(unsigned int a, unsigned int b) {
+    while (b != 0) {
+        unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function of the first kind, by its power series
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half = 0.5 * x;
+    for (int k = 1; k < 64 && term > 1e-12 * sum; ++k) {
+        term *= (half / k) * (half / k);
+        sum += term;
+    }
+    return sum;
+}
+
+bool resampler_init(Resampler *resampler, unsigned int inRate, unsigned int outRate, ResampleQuality quality) {
+    memset(resampler, 0, sizeof(*resampler));
+    if (inRate == 0 || outRate == 0 || quality >= RESAMPLE_QUALITY_COUNT) return false;
+
+    unsigned int divisor = gcd(inRate, outRate);
+    unsigned int up = outRate / divisor;
+    unsigned int down = inRate / divisor;
+    if (up > RESAMPLE_MAX_PHASES) return false;
+
+    // Kaiser design: the transition width follows from length and attenuation,
+    // and the cutoff sits half of it below the lower Nyquist frequency
+    const QualityLevel *level = &qualityLevels[quality];
+    double scale = up < down ? (double)up / down : 1.0;
+    double transition = (level->attenuation - 7.95) / (14.36 * level->taps);
+    double cutoff = scale * (0.5 - 0.5 * transition);
+    double beta = 0.1102 * (level->attenuation - 8.7);
+
+    unsigned int taps = (unsigned int)ceil(level->taps / scale);
+    taps = (taps + 7) & ~7u;
+
+    float *coefficients = (float *)malloc((size_t)up * taps * sizeof(float));
+    if (coefficients == NULL) {
+        fprintf(stderr, "Failed to allocate resampler filter (%u x %u taps)\n", up, taps);
+        return false;
+    }
+
+    double half = 0.5 * taps;
+    double window = bessel_i0(beta);
+    for (unsigned int phase = 0; phase < up; ++phase) {
+        float *row = coefficients + (size_t)phase * taps;
+        double sum = 0.0;
+
+        // Tap a weighs input frame (index - taps/2 + 1 + a), at distance x from the output
+        for (unsigned int a = 0; a < taps; ++a) {
+            double x = (double)phase / up - (double)a + half - 1.0;
+            double u = x / half;
+            double sinc = x == 0.0 ? 1.0 : sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+            double kaiser = u * u < 1.0 ? bessel_i0(beta * sqrt(1.0 - u * u)) / window : 0.0;
+            double h = 2.0 * cutoff * sinc * kaiser;
+            row[a] = (float)h;
+            sum += h;
+        }
+
+        // Unity gain at DC for every phase, so a constant stays constant
+        for (unsigned int a = 0; a < taps; ++a) {
+            row[a] = (float)(row[a] / sum);
+        }
+    }
+
+    resampler->inRate = inRate;
+    resampler->outRate = outRate;
+    resampler->up = up;
+    resampler->down = down;
+    resampler->taps = taps;
+    resampler->coefficients = coefficients;
+    return true;
+}
+
+void resampler_free(Resampler *resampler) {
+    free(resampler->coefficients);
+    memset(resampler, 0, sizeof(*resampler));
+}
+
+uint64_t resampler_output_frames(const Resampler *resampler, uint64_t inFrames) {
+    return (inFrames * resampler->up + resampler->down - 1) / resampler->down;
+}
+
+int64_t resampler_first_input(const Resampler *resampler, uint64_t output) {
+    return (int64_t)(output * resampler->down / resampler->up) - (int64_t)(resampler->taps / 2) + 1;
+}
+
+void resampler_process(const Resampler *resampler, const float *in, int64_t inStart,
+                       uint64_t firstOutput, float *out, size_t outFrames) {
+    const unsigned int up = resampler->up;
+    const unsigned int taps = resampler->taps;
+    const unsigned int step = resampler->down / up;
+    const unsigned int carry = resampler->down % up;
+
+    const float *x = in + (resampler_first_input(resampler, firstOutput) - inStart);
+    unsigned int phase = (unsigned int)(firstOutput * resampler->down % up);
+
+    for (size_t k = 0; k < outFrames; ++k) {
+        const float *h = resampler->coefficients + (size_t)phase * taps;
+
+        // Two accumulators hide the add latency
+        vf4 acc0 = vf4_zero();
+        vf4 acc1 = vf4_zero();
+        for (unsigned int a = 0; a < taps; a += 8) {
+            acc0 = vf4_madd(acc0, vf4_load(x + a), vf4_load(h + a));
+            acc1 = vf4_madd(acc1, vf4_load(x + a + 4), vf4_load(h + a + 4));
+        }
+        out[k] = vf4_hsum(vf4_add(acc0, acc1));
+
+        x += step;
+        phase += carry;
+        if (phase >= up) {
+            phase -= up;
+            x++;
+        }
+    }
+}
+
+bool resampler_convert(const Resampler *resampler, unsigned int channels, uint64_t inFrames,
+                       ResampleRead read, ResampleWrite write, void *context) {
+    // Input frames one block of output can reach
+    size_t span = (size_t)((uint64_t)(RESAMPLE_BLOCK - 1) * resampler->down / resampler->up) + resampler->taps + 2;
+
+    float *source = (float *)malloc(span * channels * sizeof(float));
+    float *planar = (float *)malloc(span * sizeof(float));
+    float *converted = (float *)malloc(RESAMPLE_BLOCK * sizeof(float));
+    float *block = (float *)malloc((size_t)RESAMPLE_BLOCK * channels * sizeof(float));
+    if (source == NULL || planar == NULL || converted == NULL || block == NULL) {
+        fprintf(stderr, "Failed to allocate resampler buffers\n");
+        free(source);
+        free(planar);
+        free(converted);
+        free(block);
+        return false;
+    }
+
+    uint64_t outFrames = resampler_output_frames(resampler, inFrames);
+    for (uint64_t first = 0; first < outFrames; first += RESAMPLE_BLOCK) {
+        size_t count = outFrames - first < RESAMPLE_BLOCK ? (size_t)(outFrames - first) : RESAMPLE_BLOCK;
+        int64_t start = resampler_first_input(resampler, first);
+        int64_t end = resampler_first_input(resampler, first + count - 1) + resampler->taps;
+
+        // The filter overhangs both ends of the input; pad with silence
+        int64_t from = start > 0 ? start : 0;
+        int64_t to = end < (int64_t)inFrames ? end : (int64_t)inFrames;
+        memset(source, 0, (size_t)(end - start) * channels * sizeof(float));
+        if (from < to) {
+            read(context, (uint64_t)from, source + (size_t)(from - start) * channels, (size_t)(to - from));
+        }
+
+        for (unsigned int c = 0; c < channels; ++c) {
+            for (int64_t i = 0; i < end - start; ++i) {
+                planar[i] = source[i * channels + c];
+            }
+            resampler_process(resampler, planar, start, first, converted, count);
+            for (size_t i = 0; i < count; ++i) {
+                block[i * channels + c] = converted[i];
+            }
+        }
+        write(context, first, block, count);
+    }
+
+    free(source);
+    free(planar);
+    free(converted);
+    free(block);
+    return true;
+}
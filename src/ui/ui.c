@@ -1,11 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "../../include/playback.h"
 #include "../../include/ui.h"
 #include "../../include/visualizers.h"
 #include "../../include/fft.h"
+#include "../../include/loudness.h"
+#include "../../include/profiler.h"
+#include "../../include/latency.h"
+#include "../../include/alloc_tracker.h"
+#include "../../include/player.h"
+#include "../../include/loader.h"
 #include <raylib.h>
 
 extern int screenWidth;
@@ -15,10 +22,16 @@ extern Color ACCENT_BLUE;
 extern Color LIGHT_TEXT;
 extern Color ACCENT_RED;
 extern Color DARKER_RED;
+extern LoudnessMeter loudnessMeter;
+extern LatencyMonitor latencyMonitor;
 
 static Layout layout;
 static bool showVisualizerList = false;
 static bool showQueue = true;
+static bool showLatency = false;
+#ifdef ENABLE_PROFILER
+static bool showProfiler = false;
+#endif
 
 void InitUI(void) {
     layout = CalculateLayout(screenWidth, screenHeight);
@@ -32,10 +45,16 @@ void RenderUI(size_t numberOfFftBins, AudioData *audioData) {
     BeginDrawing();
     ClearBackground(DARK_BACKGROUND);
 
-    HandleInput();
+    PROFILE_BEGIN(PROFILE_DRAW_UI);
     DrawUI(layout, numberOfFftBins, audioData);
+    PROFILE_END(PROFILE_DRAW_UI);
 
+    // The spectrum drawn this frame is submitted now
+    latency_update(&latencyMonitor, audioData->spectrumPosition, latency_now_ns());
+
+    PROFILE_BEGIN(PROFILE_PRESENT);
     EndDrawing();
+    PROFILE_END(PROFILE_PRESENT);
 }
 
 Layout CalculateLayout(int screenWidth, int screenHeight) {
@@ -128,7 +147,8 @@ void DrawTextCentered(const char* text, Rectangle bounds, int fontSize, Color co
     DrawText(text, bounds.x + (bounds.width - textWidth) / 2, bounds.y + (bounds.height - fontSize) / 2, fontSize, color);
 }
 
-// Handle user input separately
+// Playback hotkeys; called once per frame from the main loop, since a key
+// stays pressed for the whole frame
 void HandleInput(void) {
     // Handle other input events
     if (IsKeyPressed(KEY_SPACE)) {
@@ -140,25 +160,106 @@ void HandleInput(void) {
     if (IsKeyPressed(KEY_LEFT)) {
         SkipBackward();
     }
+    if (IsKeyPressed(KEY_S)) {
+        ShuffleQueue();
+    }
+    if (IsKeyPressed(KEY_C)) {
+        printf("Crossfade: %.0f s\n", player_step_crossfade());
+    }
+}
 
-    if (isPlaying && currentSong != NULL) {
-        UpdateMusicStream(currentSong->song);
+// Analysis hotkeys; called once per frame before ProcessFFT
+void HandleAnalysisInput(void) {
+    if (IsKeyPressed(KEY_W)) {
+        // The first use of a window type builds its table
+        ALLOC_TRACKER_ALLOW_FRAME();
+        WindowType next = (WindowType)((get_window_function() + 1) % WINDOW_TYPE_COUNT);
+        set_window_function(next);
+        printf("Window function: %s\n", window_name(get_window_function()));
+    }
+    if (IsKeyPressed(KEY_M)) {
+        currentAnalysisMode = (currentAnalysisMode == ANALYSIS_MULTI_RESOLUTION)
+            ? ANALYSIS_SINGLE_RESOLUTION : ANALYSIS_MULTI_RESOLUTION;
+        printf("Analysis mode: %s\n", currentAnalysisMode == ANALYSIS_MULTI_RESOLUTION ? "multi-resolution" : "single-resolution");
+    }
+    if (IsKeyPressed(KEY_L)) {
+        showLatency = !showLatency;
+    }
+#ifdef ENABLE_PROFILER
+    if (IsKeyPressed(KEY_P)) {
+        showProfiler = !showProfiler;
+    }
+    if (IsKeyPressed(KEY_T)) {
+        ALLOC_TRACKER_ALLOW_FRAME();
+        profiler_dump_trace(TextFormat("bragibeats-trace-%ld.json", (long)time(NULL)));
     }
+#endif
 }
 
 void UpdatePlaybackState(void) {
-    // Update playback controls
-    if (currentSong != NULL) {
-        if (GetMusicTimePlayed(currentSong->song) >= GetMusicTimeLength(currentSong->song)) {
+    // Free decoded tracks the player threads have moved past
+    player_reclaim();
+
+    QueueEntry* current = currentEntry();
+    if (current == NULL || !isPlaying) {
+        return;
+    }
+
+    // Started before its decode finished
+    if (current->track == NULL) {
+        PlayerTrack* track = NULL;
+        const char* path = play_queue_path(&playQueue, current);
+        LoaderStatus status = loader_poll(path, &track);
+        if (status == LOADER_READY) {
+            attachTrack(current, track);
+            PlayCurrentSong();
+        } else if (status == LOADER_FAILED) {
+            printf("Error: Failed to load song stream for: %s\n", play_queue_title(&playQueue, current));
+            current->status = SONG_FAILED;
+            StopCurrentSong();
+        } else if (status == LOADER_IDLE) {
+            loader_request(path, true);
+        }
+        return;
+    }
+
+    QueueEntry* next = nextEntry();
+
+    // The device has reached the prefetched successor
+    if (next != NULL && next->track != NULL && player_playing_track() == next->track) {
+        player_release(current->track);
+        current->track = NULL;
+        playQueue.current++;
+        loudness_request_reset(&loudnessMeter);
+        return;
+    }
+
+    if (player_finished()) {
+        if (next != NULL) {
+            // The successor was not decoded in time
             SkipForward();
-            if (currentSong == NULL) {
-                isPlaying = false;
-                currentSong = head;
-            } else {
-                PlayMusicStream(currentSong->song);
-                SetMusicVolume(currentSong->song, 0.5f);
-                AttachAudioStreamProcessor(currentSong->song.stream, callback);
-            }
+        } else {
+            // End of the queue: stop once rather than every frame
+            StopCurrentSong();
+        }
+        return;
+    }
+
+    // Decode the successor in the background as the end approaches, and
+    // queue it behind the current track so the switch is gapless
+    if (next != NULL && next->track == NULL && next->status != SONG_FAILED &&
+        player_playing_track() == current->track &&
+        player_time_length() - player_time_played() < PLAYER_PREFETCH_SECONDS) {
+        PlayerTrack* track = NULL;
+        const char* path = play_queue_path(&playQueue, next);
+        LoaderStatus status = loader_poll(path, &track);
+        if (status == LOADER_READY) {
+            attachTrack(next, track);
+            player_set_next(track);
+        } else if (status == LOADER_FAILED) {
+            next->status = SONG_FAILED;
+        } else if (status == LOADER_IDLE) {
+            loader_request(path, false);
         }
     }
 }
@@ -168,10 +269,12 @@ void DrawUI(Layout layout, size_t numberOfFftBins, AudioData *audioData) {
     DrawVisualizersButton();
 
     // Draw the progress bar before playback controls
-    if (currentSong != NULL) {
-        DrawProgressBar(currentSong->song, layout.progressBar);
+    PROFILE_BEGIN(PROFILE_UI_PROGRESS);
+    if (currentEntry() != NULL) {
+        DrawProgressBar(layout.progressBar);
         DrawSampleInfo(layout);
     }
+    PROFILE_END(PROFILE_UI_PROGRESS);
 
     RenderVisualizer(
         audioData->out_smooth,
@@ -179,12 +282,24 @@ void DrawUI(Layout layout, size_t numberOfFftBins, AudioData *audioData) {
         layout.visualizerSpace
     );
 
+    if (currentEntry() != NULL) {
+        DrawLoudnessMeter(layout.visualizerSpace);
+    }
+
+    if (showLatency) {
+        DrawLatencyPanel(layout.visualizerSpace);
+    }
+
     // Only draw the queue if it's visible
+    PROFILE_BEGIN(PROFILE_UI_QUEUE);
     if (showQueue) {
         DrawSongQueue(layout.queue);
     }
+    PROFILE_END(PROFILE_UI_QUEUE);
 
+    PROFILE_BEGIN(PROFILE_UI_CONTROLS);
     DrawPlaybackControls(layout.playbackControlPanel);
+    PROFILE_END(PROFILE_UI_CONTROLS);
 
     // Handle visualizer selection if needed
     if (showVisualizerList) {
@@ -203,12 +318,18 @@ void DrawUI(Layout layout, size_t numberOfFftBins, AudioData *audioData) {
 
     // Display status messages
     if (testMode) {
-        DrawStatusMessage("Test Mode Active", layout.titleBar);
+        DrawStatusMessage(TextFormat("Test Mode Active (%s window)", window_name(get_window_function())), layout.titleBar);
     } else if (isPlaying) {
         DrawStatusMessage("Playing Music...", layout.titleBar);
-    } else if (!isPlaying && (currentSong == NULL)) {
+    } else if (!isPlaying && (currentEntry() == NULL)) {
         DrawStatusMessage("No song is playing", layout.titleBar);
     }
+
+#ifdef ENABLE_PROFILER
+    if (showProfiler) {
+        DrawProfilerOverlay(layout.visualizerSpace);
+    }
+#endif
 }
 
 void DrawVisualizersButton(void) {
@@ -271,27 +392,41 @@ void DrawSongQueue(Rectangle queueBounds) {
     int startY = queueBounds.y + 10;
     int padding = 5;
     int textHeight = 20;
-    SongNode* node = head;
 
     DrawRectangleRec(queueBounds, DARK_BACKGROUND);
 
-    while (node != NULL && startY < queueBounds.y + queueBounds.height) {
+    // Only the rows that fit are visited, centred on the current song
+    size_t rows = (size_t)(queueBounds.height / (textHeight + padding));
+    size_t position = 0;
+    if (playQueue.current != PLAY_QUEUE_NONE && playQueue.current > rows / 2) {
+        position = playQueue.current - rows / 2;
+    }
+
+    for (; position < playQueue.count && startY < queueBounds.y + queueBounds.height; position++) {
+        QueueEntry* entry = play_queue_at(&playQueue, position);
         Color textColor = LIGHT_TEXT;
         Rectangle textBackground = {queueBounds.x + 5, startY, queueBounds.width - 10, textHeight};
 
-        if (node == currentSong) {
+        if (position == playQueue.current) {
             textColor = ACCENT_RED;
             DrawRectangleRec(textBackground, ACCENT_BLUE);
         }
 
-        if (CheckCollisionPointRec(GetMousePosition(), textBackground) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            playSongNode(node);
+        const char* title = play_queue_title(&playQueue, entry);
+        const char* label = title;
+        if (entry->status == SONG_PROBING) {
+            label = TextFormat("%s (loading)", title);
+        } else if (entry->status == SONG_FAILED) {
+            label = TextFormat("%s (unplayable)", title);
         }
+        DrawText(label, queueBounds.x + 10, startY + (textHeight - fontSize) / 2, fontSize, textColor);
 
-        DrawText(node->title, queueBounds.x + 10, startY + (textHeight - fontSize) / 2, fontSize, textColor);
+        if (CheckCollisionPointRec(GetMousePosition(), textBackground) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+            playQueuePosition(position);
+            break;
+        }
 
         startY += textHeight + padding;
-        node = node->next;
     }
 }
 
@@ -321,13 +456,35 @@ void DrawPlaybackControls(Rectangle playbackControlPanel) {
     }
 }
 
-void DrawProgressBar(Music music, Rectangle progressBarBounds) {
-    if (music.stream.buffer == NULL) return;
+// Position under the mouse while the progress bar is being dragged
+static bool scrubbing = false;
+static float scrubTime = 0.0f;
+
+static float DisplayedTime(void) {
+    return scrubbing ? scrubTime : player_time_played();
+}
+
+void DrawProgressBar(Rectangle progressBarBounds) {
+    float songLength = player_time_length();
+    if (songLength <= 0.0f) return;
 
     const float minProgressBarWidth = 5.0f;
 
-    float songLength = GetMusicTimeLength(music);
-    float currentTime = GetMusicTimePlayed(music);
+    // A drag that starts on the bar follows the mouse until released
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), progressBarBounds)) {
+        scrubbing = true;
+    }
+    if (scrubbing) {
+        float newProgress = (GetMouseX() - progressBarBounds.x) / (float)progressBarBounds.width;
+        newProgress = newProgress < 0.0f ? 0.0f : (newProgress > 1.0f ? 1.0f : newProgress);
+        scrubTime = newProgress * songLength;
+
+        bool released = !IsMouseButtonDown(MOUSE_LEFT_BUTTON);
+        player_scrub(scrubTime, released);
+        scrubbing = !released;
+    }
+
+    float currentTime = DisplayedTime();
     float progress = currentTime / songLength;
 
     float progressBarActualWidth = progressBarBounds.width * progress;
@@ -345,19 +502,12 @@ void DrawProgressBar(Music music, Rectangle progressBarBounds) {
     DrawRectangleLinesEx(progressBarBounds, 1, LIGHT_TEXT);
 
     // Center the time text above the progress bar
-    DrawTotalTime(music, progressBarBounds);
-
-    if (CheckCollisionPointRec(GetMousePosition(), progressBarBounds)) {
-        if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
-            float newProgress = (GetMouseX() - progressBarBounds.x) / (float)progressBarBounds.width;
-            SeekMusicStream(music, newProgress * songLength);
-        }
-    }
+    DrawTotalTime(progressBarBounds);
 }
 
-void DrawTotalTime(Music music,Rectangle progressBarBounds) {
-    float songLength = GetMusicTimeLength(music);
-    float timePlayed = GetMusicTimePlayed(music);
+void DrawTotalTime(Rectangle progressBarBounds) {
+    float songLength = player_time_length();
+    float timePlayed = DisplayedTime();
 
     int minutesTotal = (int)songLength / 60;
     int secondsTotal = (int)songLength % 60;
@@ -376,9 +526,10 @@ void DrawTotalTime(Music music,Rectangle progressBarBounds) {
 }
 
 void DrawSampleInfo(Layout layout) {
-    if (currentSong != NULL && currentSong->song.stream.buffer != NULL) {
-        int sampleSize = currentSong->song.stream.sampleSize;
-        int sampleRate = currentSong->song.stream.sampleRate;
+    QueueEntry* current = currentEntry();
+    if (current != NULL && current->sampleRate != 0) {
+        int sampleSize = current->sampleBits;
+        int sampleRate = current->sampleRate;
 
         char infoText[256];
         snprintf(infoText, sizeof(infoText), "%d Hz\n%d bit", sampleRate, sampleSize);
@@ -392,6 +543,85 @@ void DrawSampleInfo(Layout layout) {
     }
 }
 
+void DrawLoudnessMeter(Rectangle visualizerSpace) {
+    char meterText[256];
+    snprintf(meterText, sizeof(meterText), "M %6.1f LUFS\nS %6.1f LUFS\nI %6.1f LUFS\nTP %5.1f dBTP",
+             loudnessMeter.momentary, loudnessMeter.shortTerm,
+             loudnessMeter.integrated, loudnessMeter.maxTruePeak);
+
+    int fontSize = 16;
+    int textX = visualizerSpace.x + 10;
+    int textY = visualizerSpace.y + visualizerSpace.height - 4 * (fontSize + 4) - 10;
+
+    // Over 0 dBTP means inter-sample clipping after conversion
+    Color textColor = loudnessMeter.maxTruePeak > 0.0f ? DARKER_RED : LIGHT_TEXT;
+    DrawText(meterText, textX, textY, fontSize, textColor);
+}
+
+void DrawLatencyPanel(Rectangle visualizerSpace) {
+    const LatencyMonitor *monitor = &latencyMonitor;
+    char callbackText[128];
+    char latencyText[128];
+
+    if (monitor->valid) {
+        snprintf(callbackText, sizeof(callbackText), "Callback %.0f fr every %.2f ms (exp %.2f)\nJitter %.2f ms, max dev %.2f ms",
+                 monitor->callbackFrames, monitor->intervalMs, monitor->expectedIntervalMs,
+                 monitor->jitterMs, monitor->maxDeviationMs);
+    } else {
+        snprintf(callbackText, sizeof(callbackText), "Callback: no data\n");
+    }
+
+    if (monitor->latencyValid) {
+        snprintf(latencyText, sizeof(latencyText), "Arrival to draw %.1f ms (+%.0f ms window centre)",
+                 monitor->arrivalToDrawMs, monitor->windowDelayMs);
+    } else {
+        snprintf(latencyText, sizeof(latencyText), "Arrival to draw: n/a");
+    }
+
+    int fontSize = 16;
+    int lineHeight = fontSize + 4;
+    int textX = visualizerSpace.x + 10;
+    int textY = visualizerSpace.y + 10;
+
+    DrawText(callbackText, textX, textY, fontSize, LIGHT_TEXT);
+
+    // Over 100% fill means samples passed through the ring unanalysed
+    Color fillColor = monitor->ringFill > 1.0f ? ACCENT_RED : LIGHT_TEXT;
+    DrawText(TextFormat("Ring fill %llu samples (%.1f%%)", (unsigned long long)monitor->freshSamples, monitor->ringFill * 100.0f),
+             textX, textY + 2 * lineHeight, fontSize, fillColor);
+    DrawText(latencyText, textX, textY + 3 * lineHeight, fontSize, LIGHT_TEXT);
+
+    // Decode thread headroom; underruns mean it could not keep up
+    uint64_t underruns = player_underruns();
+    DrawText(TextFormat("Decoded ahead %.0f ms, %llu underruns", player_buffered_ms(), (unsigned long long)underruns),
+             textX, textY + 4 * lineHeight, fontSize, underruns > 0 ? ACCENT_RED : LIGHT_TEXT);
+}
+
+#ifdef ENABLE_PROFILER
+void DrawProfilerOverlay(Rectangle visualizerSpace) {
+    int fontSize = 14;
+    int lineHeight = fontSize + 2;
+    int width = 330;
+    int x = visualizerSpace.x + visualizerSpace.width - width - 10;
+    int y = visualizerSpace.y + 10;
+
+    DrawRectangle(x, y, width, (PROFILE_FRAME_STAGE_COUNT + 1) * lineHeight + 10, Fade(BLACK, 0.7f));
+    DrawText("stage            min    avg    p99  (ms)", x + 5, y + 5, fontSize, LIGHT_TEXT);
+
+    for (int s = 0; s < PROFILE_FRAME_STAGE_COUNT; ++s) {
+        ProfileStats stats = profiler_stats((ProfileStage)s);
+        int lineY = y + 5 + (s + 1) * lineHeight;
+        DrawText(profiler_stage_name((ProfileStage)s), x + 5, lineY, fontSize, LIGHT_TEXT);
+        if (stats.samples == 0) continue;
+
+        // Anything over one 60 FPS frame budget at p99 is what drops frames
+        Color color = stats.p99 > 16.7f ? ACCENT_RED : LIGHT_TEXT;
+        DrawText(TextFormat("%6.2f %6.2f %6.2f", stats.min, stats.avg, stats.p99),
+                 x + 125, lineY, fontSize, color);
+    }
+}
+#endif
+
 void DrawVisualizerSelection(bool* showList, Rectangle buttonBounds) {
     const char* visualizerNames[] = {"Bar Chart", "Iridescent", "3D Time Tunnel"};
     int visualizerCount = sizeof(visualizerNames) / sizeof(visualizerNames[0]);
@@ -413,7 +643,7 @@ void DrawVisualizerSelection(bool* showList, Rectangle buttonBounds) {
 }
 
 void DrawTestSignalSelection(bool* showList, Rectangle buttonBounds) {
-    const char* testSignalNames[] = {"Sine Wave", "Multi-Sine", "Chirp", "White Noise"};
+    const char* testSignalNames[] = {"Sine Wave", "Multi-Sine", "Chirp", "White Noise", "Pink Noise", "Brown Noise"};
     int testSignalCount = sizeof(testSignalNames) / sizeof(testSignalNames[0]);
     int paddingBetweenButtonAndList = 10;
     int buttonHeight = 30;
@@ -470,16 +700,24 @@ void RenderVisualizer(float out_smooth[], size_t numBins, Rectangle visualizerSp
 
     switch (currentVisualizer) {
         case VISUALIZER_BAR_CHART:
+            PROFILE_BEGIN(PROFILE_VIS_BAR_CHART);
             DrawBarChart(out_smooth, numBins, visualizerSpace);
+            PROFILE_END(PROFILE_VIS_BAR_CHART);
             break;
         case VISUALIZER_IRIDESCENT:
+            PROFILE_BEGIN(PROFILE_VIS_IRIDESCENT);
             DrawIridescentVisualizer(out_smooth, numBins, visualizerSpace);
+            PROFILE_END(PROFILE_VIS_IRIDESCENT);
             break;
         case VISUALIZER_3D_TIME_TUNNEL:
+            PROFILE_BEGIN(PROFILE_VIS_TIME_TUNNEL);
             Draw3DTimeTunnelVisualizer(out_smooth, numBins, visualizerSpace);
+            PROFILE_END(PROFILE_VIS_TIME_TUNNEL);
             break;
         default:
+            PROFILE_BEGIN(PROFILE_VIS_BAR_CHART);
             DrawBarChart(out_smooth, numBins, visualizerSpace);
+            PROFILE_END(PROFILE_VIS_BAR_CHART);
             break;
     }
 }
@@ -0,0 +1,195 @@
+// wav_map.c
+//
+// Zero-copy WAV reader. The file is mapped read-only and the RIFF chunks are
+// walked in place; sample frames are then addressed by pointer arithmetic and
+// converted to float only by whoever consumes them.
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "../../include/wav_map.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+static uint16_t read_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool parse_format(WavMap *wav, const unsigned char *fmt, uint32_t size) {
+    if (size < 16) return false;
+
+    uint16_t tag = read_u16(fmt);
+    wav->channels = read_u16(fmt + 2);
+    wav->sampleRate = read_u32(fmt + 4);
+    wav->bytesPerFrame = read_u16(fmt + 12);
+    wav->bitsPerSample = read_u16(fmt + 14);
+
+    // The sub-format GUID starts with the actual format tag
+    if (tag == WAVE_FORMAT_EXTENSIBLE) {
+        if (size < 40) return false;
+        tag = read_u16(fmt + 24);
+    }
+
+    if (wav->channels == 0 || wav->sampleRate == 0) return false;
+    if (wav->bytesPerFrame != wav->channels * (wav->bitsPerSample / 8)) return false;
+
+    if (tag == WAVE_FORMAT_PCM) {
+        switch (wav->bitsPerSample) {
+            case 8:  wav->format = WAV_SAMPLE_U8; return true;
+            case 16: wav->format = WAV_SAMPLE_S16; return true;
+            case 24: wav->format = WAV_SAMPLE_S24; return true;
+            case 32: wav->format = WAV_SAMPLE_S32; return true;
+            default: return false;
+        }
+    }
+    if (tag == WAVE_FORMAT_IEEE_FLOAT && wav->bitsPerSample == 32) {
+        wav->format = WAV_SAMPLE_F32;
+        return true;
+    }
+    return false;
+}
+
+bool wav_map_open(WavMap *wav, const char *path) {
+    memset(wav, 0, sizeof(*wav));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 44) {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) return false;
+
+    wav->mapping = mapping;
+    wav->mappingSize = (size_t)st.st_size;
+
+    const unsigned char *file = (const unsigned char *)mapping;
+    const unsigned char *end = file + wav->mappingSize;
+    if (memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) {
+        wav_map_close(wav);
+        return false;
+    }
+
+    bool haveFormat = false;
+    const unsigned char *chunk = file + 12;
+    while (end - chunk >= 8) {
+        uint32_t size = read_u32(chunk + 4);
+        const unsigned char *body = chunk + 8;
+        size_t available = (size_t)(end - body);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            haveFormat = size <= available && parse_format(wav, body, size);
+            if (!haveFormat) break;
+        } else if (memcmp(chunk, "data", 4) == 0 && haveFormat) {
+            // Streamed or truncated files overstate the data size
+            size_t bytes = size < available ? size : available;
+            wav->data = body;
+            wav->frameCount = bytes / wav->bytesPerFrame;
+            break;
+        }
+
+        if (size >= available) break;
+        chunk = body + size + (size & 1); // Chunks are word aligned
+    }
+
+    if (wav->data == NULL || wav->frameCount == 0) {
+        wav_map_close(wav);
+        return false;
+    }
+
+    // Playback and analysis both read front to back
+    posix_madvise(wav->mapping, wav->mappingSize, POSIX_MADV_SEQUENTIAL);
+    wav_map_advise(wav, 0, WAV_MAP_READAHEAD_FRAMES);
+    return true;
+}
+
+void wav_map_close(WavMap *wav) {
+    if (wav->mapping != NULL) {
+        munmap(wav->mapping, wav->mappingSize);
+    }
+    memset(wav, 0, sizeof(*wav));
+}
+
+static float sample_at(const unsigned char *p, WavSampleFormat format) {
+    switch (format) {
+        case WAV_SAMPLE_U8:
+            return ((float)p[0] - 128.0f) * (1.0f / 128.0f);
+        case WAV_SAMPLE_S16: {
+            int16_t v;
+            memcpy(&v, p, sizeof(v));
+            return (float)v * (1.0f / 32768.0f);
+        }
+        case WAV_SAMPLE_S24: {
+            // Into the top of an int32 so the sign comes along
+            int32_t v = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+            return (float)v * (1.0f / 2147483648.0f);
+        }
+        case WAV_SAMPLE_S32: {
+            int32_t v;
+            memcpy(&v, p, sizeof(v));
+            return (float)v * (1.0f / 2147483648.0f);
+        }
+        case WAV_SAMPLE_F32: {
+            float v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+    }
+    return 0.0f;
+}
+
+size_t wav_map_read_float(const WavMap *wav, uint64_t frame, float *out, size_t frames, unsigned int outChannels) {
+    if (frame >= wav->frameCount) return 0;
+    if (frames > wav->frameCount - frame) frames = (size_t)(wav->frameCount - frame);
+
+    const unsigned char *src = wav_map_frame(wav, frame);
+    unsigned int bytesPerSample = wav->bitsPerSample / 8;
+
+    // Common layout: 16-bit with the channel count the caller wants
+    if (wav->format == WAV_SAMPLE_S16 && wav->channels == outChannels) {
+        size_t samples = frames * outChannels;
+        for (size_t i = 0; i < samples; ++i) {
+            int16_t v;
+            memcpy(&v, src + i * 2, sizeof(v));
+            out[i] = (float)v * (1.0f / 32768.0f);
+        }
+        return frames;
+    }
+
+    for (size_t f = 0; f < frames; ++f) {
+        const unsigned char *in = src + f * wav->bytesPerFrame;
+        for (unsigned int c = 0; c < outChannels; ++c) {
+            unsigned int source = c < wav->channels ? c : wav->channels - 1;
+            out[f * outChannels + c] = sample_at(in + source * bytesPerSample, wav->format);
+        }
+    }
+    return frames;
+}
+
+void wav_map_advise(const WavMap *wav, uint64_t frame, uint64_t frames) {
+    if (frame >= wav->frameCount) return;
+    if (frames > wav->frameCount - frame) frames = wav->frameCount - frame;
+
+    // posix_madvise wants a page-aligned start
+    long pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)wav_map_frame(wav, frame);
+    uintptr_t aligned = start & ~(uintptr_t)(pageSize - 1);
+    size_t length = (size_t)(start - aligned) + (size_t)(frames * wav->bytesPerFrame);
+
+    posix_madvise((void *)aligned, length, POSIX_MADV_WILLNEED);
+}
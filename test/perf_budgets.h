@@ -0,0 +1,39 @@
+// perf_budgets.h
+//
+// Per-size time budgets for the performance tests in test_audioProcessing.c,
+// in microseconds per call for the median of PERF_RUNS runs. The defaults
+// leave about 3x headroom over an unoptimised (-g, no -O) build on a laptop
+// core; edit them for the host, or scale them all at run time with
+// PERF_BUDGET_SCALE=<factor> (e.g. 0.25 for an optimised build, 4 under
+// sanitizers).
+
+#ifndef PERF_BUDGETS_H
+#define PERF_BUDGETS_H
+
+#include <stddef.h>
+
+#ifndef PERF_RUNS
+#define PERF_RUNS 15
+#endif
+
+typedef enum {
+    PERF_FFT,          /**< fft() */
+    PERF_WINDOW,       /**< apply_window_function() */
+    PERF_BANDS,        /**< compute_log_bands() */
+    PERF_CROSSFADE,    /**< player_crossfade(), size in stereo frames */
+    PERF_RESAMPLE,     /**< resampler_process(), size in output frames */
+    PERF_STAGE_COUNT
+} PerfStage;
+
+typedef struct {
+    size_t size;                        /**< Transform / window / crossfade / resample length */
+    double budgetUs[PERF_STAGE_COUNT];  /**< Median time allowed per stage */
+} PerfBudget;
+
+static const PerfBudget perfBudgets[] = {
+    {  1024, {  400.0,  15.0,  150.0,   60.0,   800.0 } },
+    {  4096, { 2000.0,  50.0,  300.0,  250.0,  3000.0 } },
+    { 16384, { 8000.0, 200.0, 1000.0, 1000.0, 12000.0 } },
+};
+
+#endif // PERF_BUDGETS_H